@@ -14,8 +14,10 @@
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef RUNTIME_TABLES
 u64 betweenMask[64][64];
 u64 rankMask[64], fileMask[64], NESWMask[64], NWSEMask[64];
+#endif
 
 static void updateBit(u64* bitboard, i32 square) {
     *bitboard |= (1ULL << square);
@@ -23,7 +25,7 @@ static void updateBit(u64* bitboard, i32 square) {
 
 Position fen_to_position(char* FEN) {
     Position pos = {0};
-    memset(pos.charBoard, 0, sizeof(pos.charBoard));
+    memset(pos.board, NO_PIECE, sizeof(pos.board));
     i32 square = 56; // Start at A8
 
     while (*FEN && *FEN != ' ') {
@@ -32,23 +34,10 @@ Position fen_to_position(char* FEN) {
         } else if (*FEN >= '1' && *FEN <= '8') {
             square += *FEN - '0'; // Skip empty squares
         } else {
-            pos.charBoard[square] = *FEN;
-            if(isupper(*FEN)) updateBit(&pos.color[1], square);
-            else updateBit(&pos.color[0], square);
-            switch (*FEN) {
-                case 'P': updateBit(&pos.pawn[1], square); break;
-                case 'N': updateBit(&pos.knight[1], square); break;
-                case 'B': updateBit(&pos.bishop[1], square); break;
-                case 'R': updateBit(&pos.rook[1], square); break;
-                case 'Q': updateBit(&pos.queen[1], square); break;
-                case 'K': updateBit(&pos.king[1], square); break;
-                case 'p': updateBit(&pos.pawn[0], square); break;
-                case 'n': updateBit(&pos.knight[0], square); break;
-                case 'b': updateBit(&pos.bishop[0], square); break;
-                case 'r': updateBit(&pos.rook[0], square); break;
-                case 'q': updateBit(&pos.queen[0], square); break;
-                case 'k': updateBit(&pos.king[0], square); break;
-            }
+            PieceIndex piece = pieceToIndex[(u8)*FEN & 0x7F];
+            pos.board[square] = piece;
+            updateBit(&pos.color[PIECE_COLOR(piece)], square);
+            updateBit(&pos.piece_bb[piece], square);
             square++;
         }
         FEN++;
@@ -95,33 +84,38 @@ Position fen_to_position(char* FEN) {
 
     sscanf(FEN, "%d", &pos.fullmove_number);
 
+    pos.lazy_valid = 0;
     setAttackMasks(&pos);
 
     //Check Flag
-    if(pos.attack_mask[0] & pos.king[1]) pos.flags |= IN_CHECK;
-    if(pos.attack_mask[1] & pos.king[0]) pos.flags |= IN_CHECK;
+    if(pos.attack_mask[0] & pos.pieces[1][KING]) pos.flags |= IN_CHECK;
+    if(pos.attack_mask[1] & pos.pieces[0][KING]) pos.flags |= IN_CHECK;
 
     //Double Check Flag
     if(pos.flags & IN_CHECK){
-       i32 kign_sq = getlsb(pos.king[1]);
+       i32 kign_sq = getlsb(pos.pieces[1][KING]);
        u64 attackers = getAttackers(&pos, kign_sq, 0);
        attackers &= attackers - 1; // Allow underflow
        if(attackers) pos.flags |= IN_D_CHECK;
        
-       kign_sq = getlsb(pos.king[0]);
+       kign_sq = getlsb(pos.pieces[0][KING]);
        attackers = getAttackers(&pos, kign_sq, WHITE_TURN);
        attackers &= attackers - 1; // Allow underflow
        if(attackers) pos.flags |= IN_D_CHECK;
        
     }
 
-    pos.pinned = generatePinnedPieces(&pos);
+    getPinnedPieces(&pos);
+
+    i32 turn = pos.flags & TURN_MASK;
+    pos.checkers = getAttackers(&pos, getlsb(pos.pieces[turn][KING]), !turn);
 
-    pos.stage = calculateStage(pos);
+    pos.accum = init_eval_accum(&pos);
 
-    pos.material_eval = eval_material(&pos);
+    pos.stage = calculateStage(&pos);
 
     pos.hash = hashPosition(pos);
+    pos.pawn_hash = hashPawns(&pos);
 
     pos.hashStack = createHashStack();
     pos.hashStack.current_idx = 0;
@@ -137,7 +131,7 @@ i32 PositionToFen(Position pos, char* FEN) {
         i32 emptyCount = 0;
         for (i32 file = 0; file < 8; file++) {
             i32 square = rank * 8 + file;
-            char piece = pos.charBoard[square];
+            char piece = indexToPiece[pos.board[square]];
             if (piece == 0) {
                 emptyCount++;
             } else {
@@ -192,6 +186,7 @@ i32 PositionToFen(Position pos, char* FEN) {
 }
 
 
+#ifdef RUNTIME_TABLES
 void generateBetweenMasks() {
     for (i32 sq1 = 0; sq1 < 64; sq1++) {
         i32 rank1 = sq1 / 8;
@@ -266,6 +261,8 @@ void generateDiagonalMasks() {
     }
 }
 
+#endif
+
 void printDebug(Position position){
     char fen[128];
     PositionToFen(position, fen);
@@ -274,6 +271,8 @@ void printDebug(Position position){
 }
 
 void printPosition(Position position, char verbose){
+    setAttackMasks(&position);
+    getPinnedPieces(&position);
     char fen[128];
     PositionToFen(position, fen);
     printf("----------------------------------------------------------------------------------------------------------------------------------\n");
@@ -286,25 +285,25 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.pawn[1] & mask) printf("P ");
-            else if (position.knight[1] & mask) printf("N ");
-            else if (position.bishop[1] & mask) printf("B ");
-            else if (position.rook[1] & mask) printf("R ");
-            else if (position.queen[1] & mask) printf("Q ");
-            else if (position.king[1] & mask) printf("K ");
-            else if (position.pawn[0] & mask) printf("p ");
-            else if (position.knight[0] & mask) printf("n ");
-            else if (position.bishop[0] & mask) printf("b ");
-            else if (position.rook[0] & mask) printf("r ");
-            else if (position.queen[0] & mask) printf("q ");
-            else if (position.king[0] & mask) printf("k ");
+            if (position.pieces[1][PAWN] & mask) printf("P ");
+            else if (position.pieces[1][KNIGHT] & mask) printf("N ");
+            else if (position.pieces[1][BISHOP] & mask) printf("B ");
+            else if (position.pieces[1][ROOK] & mask) printf("R ");
+            else if (position.pieces[1][QUEEN] & mask) printf("Q ");
+            else if (position.pieces[1][KING] & mask) printf("K ");
+            else if (position.pieces[0][PAWN] & mask) printf("p ");
+            else if (position.pieces[0][KNIGHT] & mask) printf("n ");
+            else if (position.pieces[0][BISHOP] & mask) printf("b ");
+            else if (position.pieces[0][ROOK] & mask) printf("r ");
+            else if (position.pieces[0][QUEEN] & mask) printf("q ");
+            else if (position.pieces[0][KING] & mask) printf("k ");
             else if (position.en_passant & mask) printf("E ");
             else printf(". ");
 
             
             if (file == 7){
                 printf("%d   |  ", rank + 1);
-                if(rank == 7) printf("Current Turn: %s -- Quick Evaluation: %d", ((position.flags & WHITE_TURN) ? "White" : "Black"), position.material_eval);
+                if(rank == 7) printf("Current Turn: %s -- Quick Evaluation: %d", ((position.flags & WHITE_TURN) ? "White" : "Black"), eval_material(&position));
                 if(rank == 5) printf("Halfmove Clock: %d -- Fullmove Number: %d -- Game Stage: %d", position.halfmove_clock, position.fullmove_number, position.stage);
                 if(rank == 3) printf("In Check: %s -- In Double-Check: %s", (position.flags & IN_CHECK) ? "Yes" : "No", (position.flags & IN_D_CHECK) ? "Yes" : "No");
                 if(rank == 1) printf("Castling Availability: ");
@@ -390,7 +389,7 @@ void printPosition(Position position, char verbose){
         for (i32 file = 0; file < 8; file++) {
             i32 square = rank * 8 + file;
 
-            if (position.charBoard[square]) printf("%c ",position.charBoard[square]);
+            if (position.board[square] != NO_PIECE) printf("%c ", indexToPiece[position.board[square]]);
             else printf(". ");
             
             if (file == 7) printf(" |\n");
@@ -420,7 +419,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.pawn[1] & mask) printf("P ");
+            if (position.pieces[1][PAWN] & mask) printf("P ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -432,7 +431,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.bishop[1] & mask) printf("B ");
+            if (position.pieces[1][BISHOP] & mask) printf("B ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -444,7 +443,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.knight[1] & mask) printf("N ");
+            if (position.pieces[1][KNIGHT] & mask) printf("N ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -456,7 +455,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.rook[1] & mask) printf("R ");
+            if (position.pieces[1][ROOK] & mask) printf("R ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -468,7 +467,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.queen[1] & mask) printf("Q ");
+            if (position.pieces[1][QUEEN] & mask) printf("Q ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -480,7 +479,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.king[1] & mask) printf("K ");
+            if (position.pieces[1][KING] & mask) printf("K ");
             else printf(". ");
             
             if (file == 7) printf(" |\n");
@@ -509,7 +508,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.pawn[0] & mask) printf("p ");
+            if (position.pieces[0][PAWN] & mask) printf("p ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -521,7 +520,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.bishop[0] & mask) printf("b ");
+            if (position.pieces[0][BISHOP] & mask) printf("b ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -533,7 +532,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.knight[0] & mask) printf("n ");
+            if (position.pieces[0][KNIGHT] & mask) printf("n ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -545,7 +544,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.rook[0] & mask) printf("r ");
+            if (position.pieces[0][ROOK] & mask) printf("r ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -557,7 +556,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.queen[0] & mask) printf("q ");
+            if (position.pieces[0][QUEEN] & mask) printf("q ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -569,7 +568,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.king[0] & mask) printf("k ");
+            if (position.pieces[0][KING] & mask) printf("k ");
             else printf(". ");
             
             if (file == 7) printf(" |\n");
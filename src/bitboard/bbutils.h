@@ -65,13 +65,15 @@
 
 #endif
 
-extern u64 betweenMask[64][64];
-extern u64 rankMask[64], fileMask[64], NESWMask[64], NWSEMask[64];
+extern TABLE_CONST u64 betweenMask[64][64];
+extern TABLE_CONST u64 rankMask[64], fileMask[64], NESWMask[64], NWSEMask[64];
 
+#ifdef RUNTIME_TABLES
 void generateBetweenMasks();
 void generateRankMasks();
 void generateFileMasks();
 void generateDiagonalMasks();
+#endif
 
 void printBB(u64 BB);
 Position fen_to_position(char* FEN);
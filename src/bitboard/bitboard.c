@@ -18,6 +18,7 @@
 #include "magic.h"
 #include "../util.h"
 #include "../types.h"
+#include "../movement.h"
 
 
 #define B_FILE_MASK         0x0202020202020202ULL
@@ -26,14 +27,15 @@
 #define B_SHORT_CASTLE_MASK 0x6000000000000000ULL 
 #define B_LONG_CASTLE_MASK  0x0E00000000000000ULL
 
+#ifdef RUNTIME_TABLES
 static void generateKingMoveMasks(void);
 static void generateKnightMoveMasks(void);
 static void generatePawnMoveMasks(void);
 
-static u64 kingMoves[64];
-static u64 knightMoves[64];
-static u64 pawnMoves[64][8]; // sq-0 single move white sq-1 double move white sq-2 attack-left white sq-3 attack-right white 
-                                  // sq-4 -> sq-7 same for black
+u64 kingMoves[64];
+u64 knightMoves[64];
+u64 pawnMoves[64][8]; // sq-0 single move white sq-1 double move white sq-2 attack-left white sq-3 attack-right white 
+                      // sq-4 -> sq-7 same for black
 
 void generateMasks(void){
     generateKingMoveMasks();
@@ -90,7 +92,7 @@ static void generateKnightMoveMasks(void) {
     }
 }
 
-void generatePawnMoveMasks(void){
+static void generatePawnMoveMasks(void){
     for (i32 square = 0; square < 64; square++) {
         i32 rank = square / 8;
         i32 file = square % 8;
@@ -111,16 +113,18 @@ void generatePawnMoveMasks(void){
     }
 }
 
+#endif
+
 //All Attacks
 u64 generateAttacks(Position* position, i32 turn){
     u64 attack_mask = 0ULL;
-    attack_mask |= getBishopAttacks(position->bishop[turn], position->color[turn], position->color[!turn] & ~position->king[!turn]);
-    attack_mask |= getRookAttacks(  position->rook[turn],   position->color[turn], position->color[!turn] & ~position->king[!turn]);
-    attack_mask |= getBishopAttacks(position->queen[turn],  position->color[turn], position->color[!turn] & ~position->king[!turn]);
-    attack_mask |= getRookAttacks(  position->queen[turn],  position->color[turn], position->color[!turn] & ~position->king[!turn]);
-    attack_mask |= getKnightAttacks(position->knight[turn]);
-    attack_mask |= getKingAttacks(  position->king[turn]  );
-    attack_mask |= getPawnAttacks(  position->pawn[turn], turn);
+    attack_mask |= getBishopAttacks(position->pieces[turn][BISHOP], position->color[turn], position->color[!turn] & ~position->pieces[!turn][KING]);
+    attack_mask |= getRookAttacks(  position->pieces[turn][ROOK],   position->color[turn], position->color[!turn] & ~position->pieces[!turn][KING]);
+    attack_mask |= getBishopAttacks(position->pieces[turn][QUEEN],  position->color[turn], position->color[!turn] & ~position->pieces[!turn][KING]);
+    attack_mask |= getRookAttacks(  position->pieces[turn][QUEEN],  position->color[turn], position->color[!turn] & ~position->pieces[!turn][KING]);
+    attack_mask |= getKnightAttacks(position->pieces[turn][KNIGHT]);
+    attack_mask |= getKingAttacks(  position->pieces[turn][KING]  );
+    attack_mask |= getPawnAttacks(  position->pieces[turn][PAWN], turn);
     return attack_mask;
 }
 
@@ -353,15 +357,12 @@ u64 getPawnMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPassant,
     return all_moves;
 }
 
-u64 getPawnThreatMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPassant, char flags, i32 opp_king_square, Move* moveList, i32* idx) {
+u64 getPawnThreatMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPassant, char flags, u64 checkSquares, Move* moveList, i32* idx) {
     u64 all_moves = 0ULL;
     u64 occ =  0ULL;
     char turn = (flags & WHITE_TURN);
     i32 pawn_mask_idx = turn ? 0 : 4;
 
-    i32 opp_pawn_mask_idx = turn ? 4 : 0;
-    u64 check_squares = pawnMoves[opp_king_square][opp_pawn_mask_idx + 2] | pawnMoves[opp_king_square][opp_pawn_mask_idx + 3];
-
     while (pawns) {
         u64 q_moves = 0ULL;         //Quiet
         u64 dp_moves = 0ULL;        //Double Pawn
@@ -375,12 +376,12 @@ u64 getPawnThreatMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPas
 
         //Single Step
         occ = (oppPieces | ownPieces) & pawnMoves[square][pawn_mask_idx + 0];
-        if(!occ) q_moves |= (pawnMoves[square][pawn_mask_idx + 0] & check_squares);
+        if(!occ) q_moves |= (pawnMoves[square][pawn_mask_idx + 0] & checkSquares);
         
         //Double Step
         if(occ == 0 && can_double){
             occ = (oppPieces | ownPieces) & pawnMoves[square][pawn_mask_idx + 1];
-            if(!occ) dp_moves |= (pawnMoves[square][pawn_mask_idx + 1] & check_squares);
+            if(!occ) dp_moves |= (pawnMoves[square][pawn_mask_idx + 1] & checkSquares);
         }
 
         //Capture Left
@@ -479,7 +480,7 @@ u64 getKnightAttacks(u64 knights) {
 
 u64 getKnightMoves(Position* pos, Turn turn, i32* move_count) {
     u64 all_moves = 0ULL;
-    u64 knights = pos->knight[turn];
+    u64 knights = pos->pieces[turn][KNIGHT];
     u64 ownPieces = pos->color[turn];
 
     while (knights) {
@@ -527,17 +528,15 @@ u64 getKnightMovesAppend(u64 knights, u64 ownPieces, u64 oppPieces, Move* moveLi
     return all_moves;
 }
 
-u64 getKnightThreatMovesAppend(u64 knights, u64 ownPieces, u64 oppPieces, i32 opp_king_square, Move* moveList, i32* idx) {
+u64 getKnightThreatMovesAppend(u64 knights, u64 ownPieces, u64 oppPieces, u64 checkSquares, Move* moveList, i32* idx) {
     u64 all_moves = 0ULL;
 
-    u64 check_squares = knightMoves[opp_king_square];
-
     while (knights) {
         i32 square = getlsb(knights);
     
         all_moves = knightMoves[square] & ~ownPieces;
 
-        u64 check_moves = all_moves & check_squares;
+        u64 check_moves = all_moves & checkSquares;
         u64 cap_moves = all_moves & oppPieces;
         check_moves &= ~cap_moves;
 
@@ -571,7 +570,7 @@ u64 getKingAttacks(u64 kings) {
 }
 
 u64 getKingMoves(Position* pos, Turn turn, i32* count) {
-    u64 kings = pos->king[turn];
+    u64 kings = pos->pieces[turn][KING];
     u64 ownPieces = pos->color[turn];
     u64 oppAttackMask = pos->attack_mask[!turn];
     u64 all_moves = 0ULL;
@@ -666,19 +665,19 @@ u64 getAttackers(Position* pos, i32 square, i32 attackerColor){
     u64 attack_mask;
 
     attack_mask = rookAttacks(all_pieces, square);
-    attackers |= (attack_mask & (pos->queen[attackerColor] | pos->rook[attackerColor]));
+    attackers |= (attack_mask & (pos->pieces[attackerColor][QUEEN] | pos->pieces[attackerColor][ROOK]));
 
     attack_mask = bishopAttacks(all_pieces, square);
-    attackers |= (attack_mask & (pos->queen[attackerColor] | pos->bishop[attackerColor]));
+    attackers |= (attack_mask & (pos->pieces[attackerColor][QUEEN] | pos->pieces[attackerColor][BISHOP]));
 
     attack_mask = knightMoves[square];
-    attackers |= (attack_mask & pos->knight[attackerColor]);
+    attackers |= (attack_mask & pos->pieces[attackerColor][KNIGHT]);
 
     attack_mask = pawnMoves[square][pawn_mask_idx + 2] | pawnMoves[square][pawn_mask_idx + 3];
-    attackers |= (attack_mask & pos->pawn[attackerColor]);
+    attackers |= (attack_mask & pos->pieces[attackerColor][PAWN]);
 
     attack_mask = kingMoves[square];
-    attackers |= (attack_mask & pos->king[attackerColor]);
+    attackers |= (attack_mask & pos->pieces[attackerColor][KING]);
 
     return attackers;
 }
@@ -689,38 +688,116 @@ u64 getXRayAttackers(Position* pos, i32 square, i32 attackerColor, u64 removed){
     u64 attack_mask;
 
     attack_mask = rookAttacks(all_pieces, square);
-    attackers |= (attack_mask & (pos->queen[attackerColor] | pos->rook[attackerColor]));
+    attackers |= (attack_mask & (pos->pieces[attackerColor][QUEEN] | pos->pieces[attackerColor][ROOK]));
 
     attack_mask = bishopAttacks(all_pieces, square);
-    attackers |= (attack_mask & (pos->queen[attackerColor] | pos->bishop[attackerColor]));
+    attackers |= (attack_mask & (pos->pieces[attackerColor][QUEEN] | pos->pieces[attackerColor][BISHOP]));
 
     return attackers & ~removed;
 }
 
+/*
+*  Checks whether a move that didn't come from the generator (eg. the TT move) is legal in the position
+*/
+u8 isLegalMove(Position* pos, Move move){
+    i32 turn = pos->flags & TURN_MASK;
+    i32 from = GET_FROM(move);
+    i32 to   = GET_TO(move);
+    i32 flags = GET_FLAGS(move);
+    u8 piece = pos->board[from];
+    u64 to_bb = 1ULL << to;
+    u64 all_pieces = pos->color[0] | pos->color[1];
+    i32 pawn_mask_idx = turn ? 0 : 4;
+    u64 captured = 0ULL;
+    u64 reach;
+
+    if(move == NO_MOVE || piece == NO_PIECE || PIECE_COLOR(piece) != turn) return FALSE;
+    if(to_bb & pos->color[turn]) return FALSE;
+
+    // Castles are checked by the castle generator
+    if(flags == KING_CASTLE || flags == QUEEN_CASTLE){
+        if(PIECE_TYPE(piece) != KING || (pos->flags & IN_CHECK)) return FALSE;
+        Move castles[2];
+        i32 size = 0;
+        getCastleMovesAppend(all_pieces, getAttackMask(pos, !turn), pos->flags, castles, &size);
+        for(i32 i = 0; i < size; i++){
+            if(castles[i] == move) return TRUE;
+        }
+        return FALSE;
+    }
+
+    // The target square has to agree with the capture flags
+    if(flags == EP_CAPTURE){
+        if(PIECE_TYPE(piece) != PAWN || to_bb != pos->en_passant) return FALSE;
+        captured = turn ? southOne(to_bb) : northOne(to_bb);
+    }
+    else if(flags == CAPTURE || flags >= KNIGHT_PROMO_CAPTURE){
+        if(!(to_bb & pos->color[!turn]) || (to_bb & pos->pieces[!turn][KING])) return FALSE;
+        captured = to_bb;
+    }
+    else if(to_bb & all_pieces) return FALSE;
+
+    // The piece has to be able to reach the target square
+    switch(PIECE_TYPE(piece)){
+        case PAWN:
+            if(((flags & PROMOTION) != 0) != (to / 8 == (turn ? 7 : 0))) return FALSE;
+            if(captured){
+                reach = pawnMoves[from][pawn_mask_idx + 2] | pawnMoves[from][pawn_mask_idx + 3];
+            }
+            else if(flags == DOUBLE_PAWN_PUSH){
+                if(from / 8 != (turn ? 1 : 6) || (pawnMoves[from][pawn_mask_idx] & all_pieces)) return FALSE;
+                reach = pawnMoves[from][pawn_mask_idx + 1];
+            }
+            else if(flags == QUIET || (flags & PROMOTION)){
+                reach = pawnMoves[from][pawn_mask_idx];
+            }
+            else return FALSE;
+            break;
+        case KNIGHT: reach = knightMoves[from]; break;
+        case BISHOP: reach = bishopAttacks(all_pieces, from); break;
+        case ROOK:   reach = rookAttacks(all_pieces, from); break;
+        case QUEEN:  reach = bishopAttacks(all_pieces, from) | rookAttacks(all_pieces, from); break;
+        case KING:
+        default:     reach = kingMoves[from]; break;
+    }
+    if(PIECE_TYPE(piece) != PAWN && flags != QUIET && flags != CAPTURE) return FALSE;
+    if(!(reach & to_bb)) return FALSE;
+
+    // Finally the move can't leave the king attacked
+    u64 occ = (all_pieces & ~(1ULL << from) & ~captured) | to_bb;
+    i32 king_sq = PIECE_TYPE(piece) == KING ? to : getlsb(pos->pieces[turn][KING]);
+    u64 attackers = (rookAttacks(occ, king_sq)   & (pos->pieces[!turn][ROOK]   | pos->pieces[!turn][QUEEN]))
+                  | (bishopAttacks(occ, king_sq) & (pos->pieces[!turn][BISHOP] | pos->pieces[!turn][QUEEN]))
+                  | (knightMoves[king_sq] & pos->pieces[!turn][KNIGHT])
+                  | ((pawnMoves[king_sq][pawn_mask_idx + 2] | pawnMoves[king_sq][pawn_mask_idx + 3]) & pos->pieces[!turn][PAWN])
+                  | (kingMoves[king_sq] & pos->pieces[!turn][KING]);
+    return (attackers & ~captured) == 0ULL;
+}
+
 /*
 * Here be ye function to get moves for white when they are in check!
 */
 void getCheckMovesAppend(Position* pos, Move* moveList, i32* idx){
     i32 turn = pos->flags & WHITE_TURN;
-    i32 king_sq = getlsb(pos->king[turn]);
-    u64 checker_mask = getAttackers(pos, king_sq, !turn);
+    i32 king_sq = getlsb(pos->pieces[turn][KING]);
+    u64 checker_mask = pos->checkers;
     i32 checker_sq = getlsb(checker_mask);
     i32 pawn_mask_idx = turn ? 0 : 4;
     u64 ownPieces = pos->color[turn];
     u64 oppPieces = pos->color[!turn];
     u64 between_squares = betweenMask[king_sq][checker_sq];
 
-    u64 upin = ~pos->pinned; //If in check, only unpinned pieces can moves (i believe havent proven though)
+    u64 upin = ~getPinnedPieces(pos); //If in check, only unpinned pieces can moves (i believe havent proven though)
 
     
     if(pos->en_passant){
         u64 test_mask = turn ? southOne(pos->en_passant) : northOne(pos->en_passant);
         if(test_mask == checker_mask){
-            getPawnMovesAppend(pos->pawn[turn] & upin, ~(pos->en_passant), 0ULL, pos->en_passant, pos->flags, moveList, idx); 
+            getPawnMovesAppend(pos->pieces[turn][PAWN] & upin, ~(pos->en_passant), 0ULL, pos->en_passant, pos->flags, moveList, idx); 
         }
     }
     
-    u64 pawns = pos->pawn[turn] & upin;
+    u64 pawns = pos->pieces[turn][PAWN] & upin;
     getPawnMovesAppend(pawns, ~(between_squares | checker_mask), checker_mask, 0ULL, pos->flags, moveList, idx); 
     while (pawns) { //Handle the case of double forward moves
         u64 dp_moves = 0ULL;
@@ -741,14 +818,14 @@ void getCheckMovesAppend(Position* pos, Move* moveList, i32* idx){
         pawns &= pawns - 1;
     }
 
-    getKingMovesAppend(    pos->king[turn] & upin, ownPieces, oppPieces, pos->attack_mask[!turn], moveList, idx);
+    getKingMovesAppend(    pos->pieces[turn][KING] & upin, ownPieces, oppPieces, getAttackMask(pos, !turn), moveList, idx);
 
-    getKnightMovesAppend(pos->knight[turn] & upin, ~(between_squares | checker_mask), checker_mask, moveList, idx);
+    getKnightMovesAppend(pos->pieces[turn][KNIGHT] & upin, ~(between_squares | checker_mask), checker_mask, moveList, idx);
 
-    getRookMovesCheckAppend(  pos->queen[turn]  & upin, ownPieces, oppPieces, (between_squares | checker_mask), moveList, idx);
-    getBishopMovesCheckAppend(pos->queen[turn]  & upin, ownPieces, oppPieces, (between_squares | checker_mask), moveList, idx);
-    getRookMovesCheckAppend(  pos->rook[turn]   & upin, ownPieces, oppPieces, (between_squares | checker_mask), moveList, idx);
-    getBishopMovesCheckAppend(pos->bishop[turn] & upin, ownPieces, oppPieces, (between_squares | checker_mask), moveList, idx);
+    getRookMovesCheckAppend(  pos->pieces[turn][QUEEN]  & upin, ownPieces, oppPieces, (between_squares | checker_mask), moveList, idx);
+    getBishopMovesCheckAppend(pos->pieces[turn][QUEEN]  & upin, ownPieces, oppPieces, (between_squares | checker_mask), moveList, idx);
+    getRookMovesCheckAppend(  pos->pieces[turn][ROOK]   & upin, ownPieces, oppPieces, (between_squares | checker_mask), moveList, idx);
+    getBishopMovesCheckAppend(pos->pieces[turn][BISHOP] & upin, ownPieces, oppPieces, (between_squares | checker_mask), moveList, idx);
 }
 
 
@@ -875,7 +952,7 @@ static void getPinnedPawnMovesAppend(i32 king_rank, i32 king_file, u64 pinned_pa
     }
 }
 
-static void getPinnedPawnThreatMovesAppend(i32 king_rank, i32 king_file, u64 pinned_pawns, u64 ownPieces, u64 oppPieces, u64 en_passant, char flags, i32 opp_king_square, Move* moveList, i32* size) {
+static void getPinnedPawnThreatMovesAppend(i32 king_rank, i32 king_file, u64 pinned_pawns, u64 ownPieces, u64 oppPieces, u64 en_passant, char flags, u64 p_check_squares, Move* moveList, i32* size) {
     while(pinned_pawns){ //Process Each Pinned pawn Individually
         i32 pawn_sq = getlsb(pinned_pawns);
         i32 pawn_rank = pawn_sq / 8;
@@ -887,23 +964,23 @@ static void getPinnedPawnThreatMovesAppend(i32 king_rank, i32 king_file, u64 pin
             if(en_passant && (pawn_rank == (turn ? 4 : 3))){
                 i32 ep_sq = getlsb(pinned_pawns);
                 if(ep_sq % 8 == pawn_file){
-                    getPawnThreatMovesAppend(1ULL << pawn_sq, ownPieces, oppPieces, 0ULL, flags, opp_king_square, moveList, size);
+                    getPawnThreatMovesAppend(1ULL << pawn_sq, ownPieces, oppPieces, 0ULL, flags, p_check_squares, moveList, size);
                     pinned_pawns &= pinned_pawns - 1;
                     continue;
                 }
             }
         }
 
-        if(pawn_file == king_file) getPawnThreatMovesAppend(1ULL << pawn_sq, ownPieces, (oppPieces & ~pawnMoves[pawn_sq][pawn_mask_idx + 2] & ~pawnMoves[pawn_sq][pawn_mask_idx + 3]), 0ULL, flags, opp_king_square, moveList, size); //Hide black pieces that could be captured and no en-passant
+        if(pawn_file == king_file) getPawnThreatMovesAppend(1ULL << pawn_sq, ownPieces, (oppPieces & ~pawnMoves[pawn_sq][pawn_mask_idx + 2] & ~pawnMoves[pawn_sq][pawn_mask_idx + 3]), 0ULL, flags, p_check_squares, moveList, size); //Hide black pieces that could be captured and no en-passant
         else if(pawn_rank - pawn_file == king_rank - king_file){ //Up right
             u64 dir = pawnMoves[pawn_sq][turn ? 3 : 6];
             u64 occ = oppPieces & dir;
-            getPawnThreatMovesAppend(1ULL << pawn_sq, (ownPieces | ~occ), occ, en_passant & dir, flags, opp_king_square, moveList, size);
+            getPawnThreatMovesAppend(1ULL << pawn_sq, (ownPieces | ~occ), occ, en_passant & dir, flags, p_check_squares, moveList, size);
         }
         else if(pawn_rank + pawn_file == king_rank + king_file){ //Up Left
             u64 dir = pawnMoves[pawn_sq][turn ? 2 : 7]; 
             u64 occ = oppPieces & dir;
-            getPawnThreatMovesAppend(1ULL << pawn_sq, (ownPieces | ~occ), occ, en_passant & dir, flags, opp_king_square, moveList, size);
+            getPawnThreatMovesAppend(1ULL << pawn_sq, (ownPieces | ~occ), occ, en_passant & dir, flags, p_check_squares, moveList, size);
         }
         pinned_pawns &= pinned_pawns - 1;
     }
@@ -911,70 +988,71 @@ static void getPinnedPawnThreatMovesAppend(i32 king_rank, i32 king_file, u64 pin
 
 void getPinnedMovesAppend(Position* pos, Move* moveList, i32* size){
     i32 turn = pos->flags & WHITE_TURN;
-    u64 pinned = pos->pinned;
-    i32 king_sq = getlsb(pos->king[turn]);
+    u64 pinned = getPinnedPieces(pos);
+    i32 king_sq = getlsb(pos->pieces[turn][KING]);
     i32 king_rank = king_sq / 8;
     i32 king_file = king_sq % 8;
 
     //King does his thang
-    getKingMovesAppend(pos->king[turn], pos->color[turn],  pos->color[!turn], pos->attack_mask[!turn], moveList, size);
-    getCastleMovesAppend(pos->color[0] | pos->color[1], pos->attack_mask[!turn], pos->flags, moveList, size);
+    u64 oppAttackMask = getAttackMask(pos, !turn);
+    getKingMovesAppend(pos->pieces[turn][KING], pos->color[turn],  pos->color[!turn], oppAttackMask, moveList, size);
+    getCastleMovesAppend(pos->color[0] | pos->color[1], oppAttackMask, pos->flags, moveList, size);
 
     //Pinned Knights Cannot Move
-    u64 pinned_knights = pos->knight[turn] & pinned;
-    getKnightMovesAppend(pos->knight[turn] & ~pinned_knights, pos->color[turn], pos->color[!turn], moveList, size);
+    u64 pinned_knights = pos->pieces[turn][KNIGHT] & pinned;
+    getKnightMovesAppend(pos->pieces[turn][KNIGHT] & ~pinned_knights, pos->color[turn], pos->color[!turn], moveList, size);
     
-    u64 pinned_queens = pos->queen[turn] & pinned;
-    getBishopMovesAppend(pos->queen[turn] & ~pinned_queens, pos->color[turn], pos->color[!turn], moveList, size);
-    getRookMovesAppend(  pos->queen[turn] & ~pinned_queens, pos->color[turn], pos->color[!turn], moveList, size);
+    u64 pinned_queens = pos->pieces[turn][QUEEN] & pinned;
+    getBishopMovesAppend(pos->pieces[turn][QUEEN] & ~pinned_queens, pos->color[turn], pos->color[!turn], moveList, size);
+    getRookMovesAppend(  pos->pieces[turn][QUEEN] & ~pinned_queens, pos->color[turn], pos->color[!turn], moveList, size);
     getPinnedQueenMovesAppend(king_rank, king_file, pinned_queens, pos->color[turn], pos->color[!turn], moveList, size);
     
-    u64 pinned_rooks = pos->rook[turn] & pinned;
-    getRookMovesAppend(pos->rook[turn] & ~pinned_rooks, pos->color[turn], pos->color[!turn], moveList, size);
+    u64 pinned_rooks = pos->pieces[turn][ROOK] & pinned;
+    getRookMovesAppend(pos->pieces[turn][ROOK] & ~pinned_rooks, pos->color[turn], pos->color[!turn], moveList, size);
     getPinnedRookMovesAppend(king_rank, king_file, pinned_rooks, pos->color[turn], pos->color[!turn], moveList, size);
 
     //Process Pinned Bishops
-    u64 pinned_bishops = pos->bishop[turn] & pinned;
-    getBishopMovesAppend(pos->bishop[turn] & ~pinned_bishops, pos->color[turn], pos->color[!turn], moveList, size);
+    u64 pinned_bishops = pos->pieces[turn][BISHOP] & pinned;
+    getBishopMovesAppend(pos->pieces[turn][BISHOP] & ~pinned_bishops, pos->color[turn], pos->color[!turn], moveList, size);
     getPinnedBishopMovesAppend(king_rank, king_file, pinned_bishops, pos->color[turn], pos->color[!turn], moveList, size);
 
 
     //Process Pinned Pawns
-    u64 pinned_pawns = pos->pawn[turn] & pinned;
-    getPawnMovesAppend(pos->pawn[turn] & ~pinned_pawns, pos->color[turn], pos->color[!turn], pos->en_passant, pos->flags, moveList, size);
+    u64 pinned_pawns = pos->pieces[turn][PAWN] & pinned;
+    getPawnMovesAppend(pos->pieces[turn][PAWN] & ~pinned_pawns, pos->color[turn], pos->color[!turn], pos->en_passant, pos->flags, moveList, size);
     getPinnedPawnMovesAppend(king_rank, king_file, pinned_pawns, pos->color[turn], pos->color[!turn], pos->en_passant, pos->flags, moveList, size);
 }
 
-void getPinnedThreatMovesAppend(Position* pos, u64 r_check_squares, u64 b_check_squares, i32 opp_king_sq, Move* moveList, i32* size){
+void getPinnedThreatMovesAppend(Position* pos, u64 r_check_squares, u64 b_check_squares, u64 n_check_squares, u64 p_check_squares, Move* moveList, i32* size){
     i32 turn = pos->flags & TURN_MASK;
-    u64 pinned = pos->pinned;
-    i32 king_sq = getlsb(pos->king[turn]);
+    u64 pinned = getPinnedPieces(pos);
+    i32 king_sq = getlsb(pos->pieces[turn][KING]);
     i32 king_rank = king_sq / 8;
     i32 king_file = king_sq % 8;
 
     //King does his thang
-    getKingThreatMovesAppend(pos->king[turn], pos->color[turn],  pos->color[!turn], pos->attack_mask[!turn], moveList, size);
+    getKingThreatMovesAppend(pos->pieces[turn][KING], pos->color[turn],  pos->color[!turn], getAttackMask(pos, !turn), moveList, size);
 
     //Pinned Knights Cannot Move
-    u64 pinned_knights = pos->knight[turn] & pinned;
-    getKnightThreatMovesAppend(pos->knight[turn] & ~pinned_knights, pos->color[turn], pos->color[!turn], opp_king_sq, moveList, size);
+    u64 pinned_knights = pos->pieces[turn][KNIGHT] & pinned;
+    getKnightThreatMovesAppend(pos->pieces[turn][KNIGHT] & ~pinned_knights, pos->color[turn], pos->color[!turn], n_check_squares, moveList, size);
     
-    u64 pinned_queens = pos->queen[turn] & pinned;
-    getBishopThreatMovesAppend(pos->queen[turn] & ~pinned_queens, pos->color[turn], pos->color[!turn], b_check_squares, moveList, size);
-    getRookThreatMovesAppend(  pos->queen[turn] & ~pinned_queens, pos->color[turn], pos->color[!turn], r_check_squares, moveList, size);
+    u64 pinned_queens = pos->pieces[turn][QUEEN] & pinned;
+    getBishopThreatMovesAppend(pos->pieces[turn][QUEEN] & ~pinned_queens, pos->color[turn], pos->color[!turn], b_check_squares, moveList, size);
+    getRookThreatMovesAppend(  pos->pieces[turn][QUEEN] & ~pinned_queens, pos->color[turn], pos->color[!turn], r_check_squares, moveList, size);
     getPinnedQueenThreatMovesAppend(king_rank, king_file, pinned_queens, pos->color[turn], pos->color[!turn], b_check_squares, r_check_squares,  moveList, size);
     
-    u64 pinned_rooks = pos->rook[turn] & pinned;
-    getRookThreatMovesAppend(pos->rook[turn] & ~pinned_rooks, pos->color[turn], pos->color[!turn], r_check_squares, moveList, size);
+    u64 pinned_rooks = pos->pieces[turn][ROOK] & pinned;
+    getRookThreatMovesAppend(pos->pieces[turn][ROOK] & ~pinned_rooks, pos->color[turn], pos->color[!turn], r_check_squares, moveList, size);
     getPinnedRookThreatMovesAppend(king_rank, king_file, pinned_rooks, pos->color[turn], pos->color[!turn], r_check_squares, moveList, size);
 
     //Process Pinned Bishops
-    u64 pinned_bishops = pos->bishop[turn] & pinned;
-    getBishopThreatMovesAppend(pos->bishop[turn] & ~pinned_bishops, pos->color[turn], pos->color[!turn], b_check_squares, moveList, size);
+    u64 pinned_bishops = pos->pieces[turn][BISHOP] & pinned;
+    getBishopThreatMovesAppend(pos->pieces[turn][BISHOP] & ~pinned_bishops, pos->color[turn], pos->color[!turn], b_check_squares, moveList, size);
     getPinnedBishopThreatMovesAppend(king_rank, king_file, pinned_bishops, pos->color[turn], pos->color[!turn], b_check_squares, moveList, size);
 
     //Process Pinned Pawns
-    u64 pinned_pawns = pos->pawn[turn] & pinned;
-    getPawnThreatMovesAppend(pos->pawn[turn] & ~pinned_pawns, pos->color[turn], pos->color[!turn], pos->en_passant, pos->flags, opp_king_sq, moveList, size);
-    getPinnedPawnThreatMovesAppend(king_rank, king_file, pinned_pawns, pos->color[turn], pos->color[!turn], pos->en_passant, pos->flags, opp_king_sq, moveList, size);
+    u64 pinned_pawns = pos->pieces[turn][PAWN] & pinned;
+    getPawnThreatMovesAppend(pos->pieces[turn][PAWN] & ~pinned_pawns, pos->color[turn], pos->color[!turn], pos->en_passant, pos->flags, p_check_squares, moveList, size);
+    getPinnedPawnThreatMovesAppend(king_rank, king_file, pinned_pawns, pos->color[turn], pos->color[!turn], pos->en_passant, pos->flags, p_check_squares, moveList, size);
 }
\ No newline at end of file
@@ -12,13 +12,19 @@
 #include "bbutils.h"
 #include "../types.h"
 
+extern TABLE_CONST u64 kingMoves[64];
+extern TABLE_CONST u64 knightMoves[64];
+extern TABLE_CONST u64 pawnMoves[64][8];
+
+#ifdef RUNTIME_TABLES
 void generateMasks(void);
+#endif
 
 u64 knightAttacks(i32 square);
 u64 getKnightAttacks(u64 knights);
 u64 getKnightMoves(Position* pos, Turn turn, i32* move_count);
 u64 getKnightMovesAppend(u64 knights, u64 ownPieces, u64 oppPieces, Move* moveList, i32* idx);
-u64 getKnightThreatMovesAppend(u64 knights, u64 ownPieces, u64 oppPieces, i32 opp_king_square, Move* moveList, i32* idx);
+u64 getKnightThreatMovesAppend(u64 knights, u64 ownPieces, u64 oppPieces, u64 checkSquares, Move* moveList, i32* idx);
 
 u64 getBishopAttacks(u64 bishops, u64 ownPieces, u64 oppPieces);
 u64 getBishopMovesAppend(u64 bishops, u64 ownPieces, u64 oppPieces, Move* moveList, i32* idx);
@@ -31,7 +37,7 @@ u64 getRookThreatMovesAppend(u64 rooks, u64 ownPieces, u64 oppPieces, u64 checkS
 u64 pawnAttacks(u64 square, char turn);
 u64 getPawnAttacks(u64 pawns, char flags);
 u64 getPawnMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPassant, char flags, Move* moveList, i32* idx);
-u64 getPawnThreatMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPassant, char flags, i32 opp_king_square, Move* moveList, i32* idx);
+u64 getPawnThreatMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPassant, char flags, u64 checkSquares, Move* moveList, i32* idx);
 
 u64 kingAttacks(Square sq);
 u64 getKingAttacks(u64 kings);
@@ -44,15 +50,27 @@ void getCastleMovesAppend(u64 white, u64 b_attack_mask, char flags, Move* moveLi
 void getCheckMovesAppend(Position* position, Move* moveList, i32* idx);
 
 void getPinnedMovesAppend(Position* position, Move* moveList, i32* idx);
-void getPinnedThreatMovesAppend(Position* position, u64 r_check_squares, u64 b_check_squares, i32 kingSq, Move* moveList, i32* idx);
+void getPinnedThreatMovesAppend(Position* position, u64 r_check_squares, u64 b_check_squares, u64 n_check_squares, u64 p_check_squares, Move* moveList, i32* idx);
 
 u64 getAttackers(Position* pos, i32 square, i32 attackerColor);
 u64 getXRayAttackers(Position* pos, i32 square, i32 attackerColor, u64 removed);
+u8 isLegalMove(Position* pos, Move move);
 
 u64 generateAttacks(Position* position, i32 turn);
 
 static inline void setAttackMasks(Position* pos){
     pos->attack_mask[1] = generateAttacks(pos, 1);
     pos->attack_mask[0] = generateAttacks(pos, 0);
+    pos->lazy_valid |= LAZY_B_ATTACKS | LAZY_W_ATTACKS;
+}
+
+/* Returns the squares attacked by color, generating them on the first call after a move */
+static inline u64 getAttackMask(Position* pos, i32 color){
+    u8 valid = color ? LAZY_W_ATTACKS : LAZY_B_ATTACKS;
+    if(!(pos->lazy_valid & valid)){
+        pos->attack_mask[color] = generateAttacks(pos, color);
+        pos->lazy_valid |= valid;
+    }
+    return pos->attack_mask[color];
 }
 #endif /* bitboard_h */
@@ -4,6 +4,22 @@
 #include <stdlib.h>
 #include <time.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PEXT_AVAILABLE
+#ifdef __BMI2__
+#define PEXT_FUNC static inline
+#else
+#define PEXT_FUNC __attribute__((target("bmi2"))) static // Only reached through the runtime cpu check
+#endif
+#endif
+
+#define NOT_FILE_0 0xfefefefefefefefeULL
+#define NOT_FILE_7 0x7f7f7f7f7f7f7f7fULL
+
+#define BENCH_OCCUPANCIES 4096
+#define BENCH_ROUNDS      64
+
 
 //static u64 find_magic(i32 sq, i32 m, i32 bishop);
 static u64 rmask(i32 sq);
@@ -12,21 +28,18 @@ static u64 ratt(i32 sq, u64 block);
 static u64 batt(i32 sq, u64 block);
 static u64 index_to_uint64(i32 index, i32 bits, u64 m);
 static i32 count_1s(u64 b);
-static i32 verifyMagic(i32 square, i32 isBishop);
-static i32 initAttackTable(void);
+static i32 verifyMagic(i32 square, i32 isBishop, i32 backend);
+static const char* backend_names[3] = {"magic", "pext", "fill"};
+
+#ifdef RUNTIME_TABLES
+static i32 initAttackTable(i32 backend);
 static void calculateAttackTableOffsets();
 static i32 transform(u64 b, u64 magic, i32 bits);
 
-static u64 attack_table[108000];
+u64 magic_attack_table[ATTACK_TABLE_SIZE];
+u64 pext_attack_table[ATTACK_TABLE_SIZE];
 static i32 attack_table_offsets[128];
 
-typedef struct {
-    u64* ptr;
-    u64 mask;
-    u64 magic;
-    i32 shift;
-} SMagic;
-
 SMagic mBishopTbl[64];
 SMagic mRookTbl[64];
 
@@ -165,6 +178,8 @@ static const u64 bishop_magics[64] = {
 };
 
 
+#endif
+
 const i32 BitTable[64] = {
   63, 30, 3, 32, 25, 41, 22, 33, 15, 50, 42, 13, 11, 53, 19, 34, 61, 29, 2,
   51, 21, 43, 45, 10, 18, 47, 1, 54, 9, 57, 0, 35, 62, 31, 40, 4, 49, 5, 52,
@@ -172,7 +187,8 @@ const i32 BitTable[64] = {
   58, 20, 37, 17, 36, 8
 };
 
-i32 RBits[64] = {
+#ifdef RUNTIME_TABLES
+static const i32 RBits[64] = {
   12, 11, 11, 11, 11, 11, 11, 12,
   11, 10, 10, 10, 10, 10, 10, 11,
   11, 10, 10, 10, 10, 10, 10, 11,
@@ -183,7 +199,7 @@ i32 RBits[64] = {
   12, 11, 11, 11, 11, 11, 11, 12
 };
 
-i32 BBits[64] = {
+static const i32 BBits[64] = {
   6, 5, 5, 5, 5, 5, 5, 6,
   5, 5, 5, 5, 5, 5, 5, 5,
   5, 5, 7, 7, 7, 7, 5, 5,
@@ -194,61 +210,204 @@ i32 BBits[64] = {
   6, 5, 5, 5, 5, 5, 5, 6
 };
 
+/*
+ * Fills both slider table layouts and checks the compiled backend against them
+ */
 i32 generateMagics(void) {
-  #ifdef __RAND_SEED
-  srand(__RAND_SEED);
-  #else
-  time_t t;
-  srand((unsigned) time(&t));
-  #endif
-
   calculateAttackTableOffsets();
 
   for(int square = 0; square < 64; square++){
-      mRookTbl[square].magic = rook_magics[square];
-      mRookTbl[square].mask  = rmask(square);
-      mRookTbl[square].shift = 64 - RBits[square];
-      mRookTbl[square].ptr = &attack_table[attack_table_offsets[square]];
+      mRookTbl[square].magic    = rook_magics[square];
+      mRookTbl[square].mask     = rmask(square);
+      mRookTbl[square].shift    = 64 - RBits[square];
+      mRookTbl[square].ptr      = &magic_attack_table[attack_table_offsets[square]];
+      mRookTbl[square].pext_ptr = &pext_attack_table[attack_table_offsets[square]];
   }
 
   for(int square = 0; square < 64; square++){
-      mBishopTbl[square].magic = bishop_magics[square];
-      mBishopTbl[square].mask  = bmask(square);
-      mBishopTbl[square].shift = 64 - BBits[square];
-      mBishopTbl[square].ptr   = &attack_table[attack_table_offsets[square + 64]];
+      mBishopTbl[square].magic    = bishop_magics[square];
+      mBishopTbl[square].mask     = bmask(square);
+      mBishopTbl[square].shift    = 64 - BBits[square];
+      mBishopTbl[square].ptr      = &magic_attack_table[attack_table_offsets[square + 64]];
+      mBishopTbl[square].pext_ptr = &pext_attack_table[attack_table_offsets[square + 64]];
   }
 
-  initAttackTable();
+  initAttackTable(SLIDER_MAGIC);
+  initAttackTable(SLIDER_PEXT);
 
   for (int square = 0; square < 64; ++square) {
-      if (verifyMagic(square, 0)) {
-          printf("info string Verification failed for rook magic at square %d\n", square);
+      if (verifyMagic(square, 0, SLIDER_BACKEND)) {
+          printf("info string Verification failed for rook %s at square %d\n", backend_names[SLIDER_BACKEND], square);
           return -1;
       }
   }
 
   for (int square = 0; square < 64; ++square) {
-      if (verifyMagic(square, 1)) {
-          printf("info string Verification failed for bishop magic at square %d\n", square);
+      if (verifyMagic(square, 1, SLIDER_BACKEND)) {
+          printf("info string Verification failed for bishop %s at square %d\n", backend_names[SLIDER_BACKEND], square);
           return -1;
       }
   }
 
   return 0;
 }
+#endif
+
+/*
+ * Slider lookups for each backend, the exported functions pick one at compile time
+ */
+static inline u64 magicBishopAttacks(u64 occ, i32 sq) {
+   const u64* aptr = mBishopTbl[sq].ptr;
+   occ           &= mBishopTbl[sq].mask;
+   occ           *= mBishopTbl[sq].magic;
+   occ          >>= mBishopTbl[sq].shift;
+   return aptr[occ];
+}
+
+static inline u64 magicRookAttacks(u64 occ, i32 sq) {
+   const u64* aptr = mRookTbl[sq].ptr;
+   occ           &= mRookTbl[sq].mask;
+   occ           *= mRookTbl[sq].magic;
+   occ          >>= mRookTbl[sq].shift;
+   return aptr[occ];
+}
+
+#ifdef PEXT_AVAILABLE
+PEXT_FUNC u64 pextBishopAttacks(u64 occ, i32 sq) {
+   return mBishopTbl[sq].pext_ptr[_pext_u64(occ, mBishopTbl[sq].mask)];
+}
+
+PEXT_FUNC u64 pextRookAttacks(u64 occ, i32 sq) {
+   return mRookTbl[sq].pext_ptr[_pext_u64(occ, mRookTbl[sq].mask)];
+}
+#endif
+
+/*
+ * Kogge-Stone occluded fills, shift is the step towards increasing (up) or decreasing (down) squares
+ * and wrap masks out the file a step would wrap around to
+ */
+static inline u64 fillUp(u64 gen, u64 empty, i32 shift, u64 wrap) {
+   empty &= wrap;
+   gen   |= empty & (gen << shift);
+   empty &= empty << shift;
+   gen   |= empty & (gen << (shift << 1));
+   empty &= empty << (shift << 1);
+   gen   |= empty & (gen << (shift << 2));
+   return (gen << shift) & wrap;
+}
 
-static i32 verifyMagic(i32 square, i32 isBishop) {
+static inline u64 fillDown(u64 gen, u64 empty, i32 shift, u64 wrap) {
+   empty &= wrap;
+   gen   |= empty & (gen >> shift);
+   empty &= empty >> shift;
+   gen   |= empty & (gen >> (shift << 1));
+   empty &= empty >> (shift << 1);
+   gen   |= empty & (gen >> (shift << 2));
+   return (gen >> shift) & wrap;
+}
+
+static inline u64 fillBishopAttacks(u64 occ, i32 sq) {
+   u64 gen = 1ULL << sq;
+   u64 empty = ~occ;
+   return fillUp(gen, empty, 9, NOT_FILE_0) | fillUp(gen, empty, 7, NOT_FILE_7) |
+          fillDown(gen, empty, 7, NOT_FILE_0) | fillDown(gen, empty, 9, NOT_FILE_7);
+}
+
+static inline u64 fillRookAttacks(u64 occ, i32 sq) {
+   u64 gen = 1ULL << sq;
+   u64 empty = ~occ;
+   return fillUp(gen, empty, 8, ~0ULL) | fillDown(gen, empty, 8, ~0ULL) |
+          fillUp(gen, empty, 1, NOT_FILE_0) | fillDown(gen, empty, 1, NOT_FILE_7);
+}
+
+static u64 backendAttacks(u64 occ, i32 sq, i32 isBishop, i32 backend) {
+   switch(backend){
+      #ifdef PEXT_AVAILABLE
+      case SLIDER_PEXT:
+         return isBishop ? pextBishopAttacks(occ, sq) : pextRookAttacks(occ, sq);
+      #endif
+      case SLIDER_FILL:
+         return isBishop ? fillBishopAttacks(occ, sq) : fillRookAttacks(occ, sq);
+      default:
+         return isBishop ? magicBishopAttacks(occ, sq) : magicRookAttacks(occ, sq);
+   }
+}
+
+static i32 backendAvailable(i32 backend) {
+   if(backend != SLIDER_PEXT) return TRUE;
+   #ifdef PEXT_AVAILABLE
+   return __builtin_cpu_supports("bmi2");
+   #else
+   return FALSE;
+   #endif
+}
+
+/*
+ * Runs the exhaustive check over every backend this cpu supports
+ */
+i32 verifySliderBackends(void) {
+   i32 failed = 0;
+   for(i32 backend = SLIDER_MAGIC; backend <= SLIDER_FILL; backend++){
+      if(!backendAvailable(backend)) {
+         printf("info string Skipping %s sliders, not supported on this cpu\n", backend_names[backend]);
+         continue;
+      }
+      for(i32 square = 0; square < 64; square++){
+         if(verifyMagic(square, 0, backend) || verifyMagic(square, 1, backend)){
+            printf("info string Verification failed for %s sliders at square %d\n", backend_names[backend], square);
+            failed = -1;
+            break;
+         }
+      }
+   }
+   return failed;
+}
+
+/*
+ * Times a rook and a bishop lookup per square over random occupancies, reported per single lookup
+ */
+#define BENCH_BACKEND(BISHOP, ROOK) do { \
+   clock_gettime(CLOCK_MONOTONIC, &start); \
+   for(i32 round = 0; round < BENCH_ROUNDS; round++){ \
+      for(i32 i = 0; i < BENCH_OCCUPANCIES; i++){ \
+         for(i32 sq = 0; sq < 64; sq++){ \
+            sink ^= BISHOP(occupancies[i], sq) + ROOK(occupancies[i] ^ sink, sq); \
+         } \
+      } \
+   } \
+   clock_gettime(CLOCK_MONOTONIC, &end); \
+} while(0)
+
+void benchSliderBackends(void) {
+   static u64 occupancies[BENCH_OCCUPANCIES];
+   struct timespec start, end;
+   u64 sink = 0;
+   for(i32 i = 0; i < BENCH_OCCUPANCIES; i++) occupancies[i] = random_uint64() & random_uint64();
+
+   for(i32 backend = SLIDER_MAGIC; backend <= SLIDER_FILL; backend++){
+      if(!backendAvailable(backend)) continue;
+      switch(backend){
+         #ifdef PEXT_AVAILABLE
+         case SLIDER_PEXT: BENCH_BACKEND(pextBishopAttacks, pextRookAttacks); break;
+         #endif
+         case SLIDER_FILL: BENCH_BACKEND(fillBishopAttacks, fillRookAttacks); break;
+         default:          BENCH_BACKEND(magicBishopAttacks, magicRookAttacks); break;
+      }
+      double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+      printf("info string %s sliders: %.2f ns per lookup%s\n", backend_names[backend],
+             ns / (2.0 * BENCH_ROUNDS * BENCH_OCCUPANCIES * 64), backend == SLIDER_BACKEND ? " (compiled in)" : "");
+   }
+   printf("info string checksum %llx\n", (unsigned long long)sink);
+}
+
+static i32 verifyMagic(i32 square, i32 isBishop, i32 backend) {
     u64 mask = isBishop ? bmask(square) : rmask(square);
     i32 num_blocker_configs = 1 << count_1s(mask);
 
     for (i32 blockers = 0; blockers < num_blocker_configs; ++blockers) {
         u64 blocker_bits = index_to_uint64(blockers, count_1s(mask), mask);
         u64 expected_attack = isBishop ? batt(square, blocker_bits) : ratt(square, blocker_bits);
-        #ifdef DEBUG_MAGIC
-        u64 actual_attack = isBishop ? DEBUG_MAGIC_bishopAttacks(blocker_bits, square) : DEBUG_MAGIC_rookAttacks(blocker_bits, square);
-        #else
-        u64 actual_attack = isBishop ? bishopAttacks(blocker_bits, square) : rookAttacks(blocker_bits, square);
-        #endif
+        u64 actual_attack = backendAttacks(blocker_bits, square, isBishop, backend);
 
         if (actual_attack != expected_attack) {
             printf("info string Failed with expected attack: 0x%llx, actual attack was: 0x%llx\n",
@@ -261,8 +420,13 @@ static i32 verifyMagic(i32 square, i32 isBishop) {
     return 0;
 }
 
-static i32 initAttackTable() {
-    printf("info string Initializing the attack table!\n");
+#ifdef RUNTIME_TABLES
+/*
+ * Fills the attack table laid out for the magic or pext index
+ */
+static i32 initAttackTable(i32 backend) {
+    printf("info string Initializing the %s attack table!\n", backend_names[backend]);
+    u64* attack_table = backend == SLIDER_PEXT ? pext_attack_table : magic_attack_table;
 
     // Rooks
     for (i32 sq = 0; sq < 64; ++sq) {
@@ -270,7 +434,7 @@ static i32 initAttackTable() {
         i32 num_blocker_configs = 1 << count_1s(mask);
         for (i32 blockers = 0; blockers < num_blocker_configs; ++blockers) {
             u64 blocker_bits = index_to_uint64(blockers, count_1s(mask), mask);
-            u64 index = transform(blocker_bits, mRookTbl[sq].magic, RBits[sq]);
+            u64 index = backend == SLIDER_PEXT ? (u64)blockers : (u64)transform(blocker_bits, mRookTbl[sq].magic, RBits[sq]);
             attack_table[attack_table_offsets[sq] + index] = ratt(sq, blocker_bits);
         }
     }
@@ -281,7 +445,7 @@ static i32 initAttackTable() {
         i32 num_blocker_configs = 1 << count_1s(mask);
         for (i32 blockers = 0; blockers < num_blocker_configs; ++blockers) {
             u64 blocker_bits = index_to_uint64(blockers, count_1s(mask), mask);
-            u64 index = transform(blocker_bits, mBishopTbl[sq].magic, BBits[sq]);
+            u64 index = backend == SLIDER_PEXT ? (u64)blockers : (u64)transform(blocker_bits, mBishopTbl[sq].magic, BBits[sq]);
             attack_table[attack_table_offsets[sq + 64] + index] = batt(sq, blocker_bits);
         }
     }
@@ -305,22 +469,27 @@ static void calculateAttackTableOffsets() {
         offset += num_blocker_configs;
     }
 }
+#endif
 
 
 u64 bishopAttacks(u64 occ, i32 sq) {
-   u64* aptr = mBishopTbl[sq].ptr;
-   occ           &= mBishopTbl[sq].mask;
-   occ           *= mBishopTbl[sq].magic;
-   occ          >>= mBishopTbl[sq].shift;
-   return aptr[occ];
+   #if SLIDER_BACKEND == SLIDER_PEXT
+   return pextBishopAttacks(occ, sq);
+   #elif SLIDER_BACKEND == SLIDER_FILL
+   return fillBishopAttacks(occ, sq);
+   #else
+   return magicBishopAttacks(occ, sq);
+   #endif
 }
 
 u64 rookAttacks(u64 occ, i32 sq) {
-   u64* aptr = mRookTbl[sq].ptr;
-   occ           &= mRookTbl[sq].mask;
-   occ           *= mRookTbl[sq].magic;
-   occ          >>= mRookTbl[sq].shift;
-   return aptr[occ];
+   #if SLIDER_BACKEND == SLIDER_PEXT
+   return pextRookAttacks(occ, sq);
+   #elif SLIDER_BACKEND == SLIDER_FILL
+   return fillRookAttacks(occ, sq);
+   #else
+   return magicRookAttacks(occ, sq);
+   #endif
 }
 
 u64 random_uint64_fewbits() {
@@ -412,9 +581,11 @@ static u64 batt(i32 sq, u64 block) {
   return result;
 }
 
+#ifdef RUNTIME_TABLES
 static i32 transform(u64 b, u64 magic, i32 bits) {
   return (i32)((b * magic) >> (64 - bits));
 }
+#endif
 
 /*
 static u64 find_magic(i32 sq, i32 m, i32 bishop) {
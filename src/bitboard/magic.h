@@ -4,7 +4,50 @@
 #include <stdint.h>
 #include "../types.h"
 
+/*
+ * Slider attack backends, selected at compile time with -DSLIDER_BACKEND=<n>
+ *   SLIDER_MAGIC - multiply and shift magic index into the attack table
+ *   SLIDER_PEXT  - BMI2 pext index into the same table layout
+ *   SLIDER_FILL  - table free Kogge-Stone occluded fill
+ * Defaults to PEXT when compiling for a BMI2 target and magics otherwise.
+ * Zen 1 and Zen 2 report BMI2 but microcode pext, build those with magics.
+ */
+#define SLIDER_MAGIC 0
+#define SLIDER_PEXT  1
+#define SLIDER_FILL  2
+
+#ifndef SLIDER_BACKEND
+#ifdef __BMI2__
+#define SLIDER_BACKEND SLIDER_PEXT
+#else
+#define SLIDER_BACKEND SLIDER_MAGIC
+#endif
+#endif
+
+#if SLIDER_BACKEND == SLIDER_PEXT && !defined(__BMI2__)
+#error "SLIDER_PEXT needs a BMI2 target, add -mbmi2 or -march=native"
+#endif
+
+#define ATTACK_TABLE_SIZE 108000
+
+typedef struct {
+    const u64* ptr;      // Magic indexed attacks
+    const u64* pext_ptr; // Pext indexed attacks
+    u64 mask;
+    u64 magic;
+    i32 shift;
+} SMagic;
+
+extern TABLE_CONST u64 magic_attack_table[ATTACK_TABLE_SIZE];
+extern TABLE_CONST u64 pext_attack_table[ATTACK_TABLE_SIZE];
+extern TABLE_CONST SMagic mBishopTbl[64];
+extern TABLE_CONST SMagic mRookTbl[64];
+
+#ifdef RUNTIME_TABLES
 i32 generateMagics(void);
+#endif
+i32 verifySliderBackends(void);
+void benchSliderBackends(void);
 u64 bishopAttacks(u64 occ, i32 sq);
 u64 rookAttacks(u64 occ, i32 sq);
 #endif
\ No newline at end of file
@@ -6,19 +6,55 @@
 #include "movement.h"
 #include "bitboard/bbutils.h"
 #include "bitboard/bitboard.h"
-
-i32 PST[2][12][64];
-
-/* Phase Information */
-enum Phase{
-    PHASE_MG = 0,
-    PHASE_EG = 1,
-
-    MINOR_PHASE = 1,
-    ROOK_PHASE  = 2,
-    QUEEN_PHASE = 4,
-    TOTAL_PHASE_VALUE = 24
-};
+#include "threads.h"
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef RUNTIME_TABLES
+Score PST[12][64];
+Score LazyGain[6];
+Score LazyLoss[6];
+#endif
+
+/* Pawn Hash Table */
+#define PAWN_HASH_ENTRIES (1 << 11) // 128 KB per thread, a power of two so the low hash bits pick the slot
+
+typedef struct {
+    alignas(64) u64 key;    // Position pawn_hash, no pawns at all hashes to 0 which matches the zeroed table
+    Score score[2];         // Structure of the pawns by turn, material and PST are in the accumulators
+    u64 attacks_west[2];    // Kept per direction so king attack units count each attacking pawn
+    u64 attacks_east[2];
+    u8 light_pawn_count[2];
+    u8 dark_pawn_count[2];
+} PawnHashEntry;
+
+_Static_assert(sizeof(PawnHashEntry) == 64, "PawnHashEntry does not fill exactly one cache line");
+
+static _Thread_local PawnHashEntry pawn_table[PAWN_HASH_ENTRIES]; // One table per search thread, nothing to synchronise
+static _Thread_local u64 pawn_probes = 0;
+static _Thread_local u64 pawn_hits   = 0;
+
+/* Lazy Evaluation */
+static _Thread_local u64 eval_calls = 0;
+static _Thread_local u64 lazy_exits = 0;  // Calls that returned a bound after the cheap stage
+
+/* Eval Cache */
+typedef struct {
+    u32 key;                // High half of the position hash, the low bits already picked the slot
+    i32 eval;
+} EvalCacheEntry;
+
+typedef struct {
+    alignas(64) EvalCacheEntry* entries;  // Direct mapped, a power of two
+    u64 mask;
+    u64 probes;                           // Only written by the owning thread
+    u64 hits;
+} EvalCache;
+
+static EvalCache eval_caches[MAX_THREADS];                        // Indexed by search thread number
+static _Thread_local EvalCache* eval_cache = NULL;                // The cache of the calling thread, NULL when it has none
+static u64 eval_cache_entries = EVAL_CACHE_DEFAULT_KB * 1024 / sizeof(EvalCacheEntry);
 
 
 /* Material Values */
@@ -30,6 +66,33 @@ const i32 RookValue   =   5000;
 const i32 QueenValue  =  10000;
 const i32 KingValue   = 100000;
 
+// Kings are on the board in every position so they carry no material in the accumulators
+const i32 PieceValue[12] = {
+    [WHITE_PAWN  ] = PawnValue,
+    [BLACK_PAWN  ] = PawnValue,
+    [WHITE_KNIGHT] = KnightValue,
+    [BLACK_KNIGHT] = KnightValue,
+    [WHITE_BISHOP] = BishopValue,
+    [BLACK_BISHOP] = BishopValue,
+    [WHITE_ROOK  ] = RookValue,
+    [BLACK_ROOK  ] = RookValue,
+    [WHITE_QUEEN ] = QueenValue,
+    [BLACK_QUEEN ] = QueenValue,
+    [WHITE_KING  ] = 0,
+    [BLACK_KING  ] = 0
+};
+
+const i32 PiecePhase[12] = {
+    [WHITE_KNIGHT] = MINOR_PHASE,
+    [BLACK_KNIGHT] = MINOR_PHASE,
+    [WHITE_BISHOP] = MINOR_PHASE,
+    [BLACK_BISHOP] = MINOR_PHASE,
+    [WHITE_ROOK  ] = ROOK_PHASE,
+    [BLACK_ROOK  ] = ROOK_PHASE,
+    [WHITE_QUEEN ] = QUEEN_PHASE,
+    [BLACK_QUEEN ] = QUEEN_PHASE
+};
+
 /* Piece-Square Tables */
 
 const i32 PSTPawn[2][64] = {
@@ -187,24 +250,22 @@ const i32 KnightAdjust[9] = { -200, -160, -120, -80, -40,  0,  40,  80, 120 };
 const i32   RookAdjust[9] = {  150,  120,   90,  60,  30,  0, -30, -60, -90 };
 
 /* King Saftey Values */
-const i32 KingPawnDistancePenalty[2] = { -20, -200 };
+const Score KingPawnDistancePenalty = S(-20, -200);
 
-const i32 OpenFileNearKingPenalty[2] = { -200, -100 };
+const Score OpenFileNearKingPenalty = S(-200, -100);
 
-const i32 VirtualMobility[2][28] = {
-    {
-        0,    0,    0,    0,    0,    0,    0,  -50, -100, -125, -150, -175,  -200,  -250,
-        -300, -350, -400, -500, -500, -500, -500, -500, -500, -500, -500,  -500, -500, -500,
-    },
-    {
-          0,    0,    0,    0,    0,    0,    0,  -5, -15, -20, -30, -40, -50, -60,
-        -70,  -70,  -70,  -70,  -70,  -70,  -70, -70, -70, -70, -70, -70, -70, -70,
-    },
+const Score VirtualMobility[28] = {
+    S(0, 0),       S(0, 0),       S(0, 0),       S(0, 0),       S(0, 0),
+    S(0, 0),       S(0, 0),       S(-50, -5),    S(-100, -15),  S(-125, -20),
+    S(-150, -30),  S(-175, -40),  S(-200, -50),  S(-250, -60),  S(-300, -70),
+    S(-350, -70),  S(-400, -70),  S(-500, -70),  S(-500, -70),  S(-500, -70),
+    S(-500, -70),  S(-500, -70),  S(-500, -70),  S(-500, -70),  S(-500, -70),
+    S(-500, -70),  S(-500, -70),  S(-500, -70)
 };
 
-const i32 PawnsInKingArea[2][9] = {
-    {  -50, -10, 25,  20,  30,  30,  30,  30,  30 },
-    { -100, -50,  0,   0,   0,   0,   0,   0,   0 },
+const Score PawnsInKingArea[9] = {
+    S(-50, -100),  S(-10, -50),   S(25, 0),      S(20, 0),      S(30, 0),
+    S(30, 0),      S(30, 0),      S(30, 0),      S(30, 0)
 };
 
 enum AttackUnits {
@@ -215,324 +276,388 @@ enum AttackUnits {
     ATTACK_UNIT_QUEEN  = 6,
 };
 
-const i32 SafetyTable[2][100] = {
-    [PHASE_MG] =
-    {
-           0,    0,   10,   20,   30,   50,   70,   90,  120,  150,
-         180,  220,  260,  300,  350,  390,  440,  500,  560,  620,
-         680,  750,  820,  850,  890,  970, 1050, 1130, 1220, 1310,
-        1400, 1500, 1690, 1800, 1910, 2020, 2130, 2250, 2370, 2480,
-        2600, 2720, 2830, 2950, 3070, 3190, 3300, 3420, 3540, 3660,
-        3770, 3890, 4010, 4120, 4240, 4360, 4480, 4590, 4710, 4830,
-        4940, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000,
-        5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000,
-        5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000,
-        5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000
-    },
-    [PHASE_EG] =
-    {
-          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   
-          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   
-          0,   0,   0,   1,   1,   2,   3,   4,   5,   6,
-          8,  10,  13,  16,  20,  25,  30,  36,  42,  48,
-         55,  62,  70,  80,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,
-    }
+const Score SafetyTable[100] = {
+    S(0, 0),      S(0, 0),      S(10, 0),     S(20, 0),     S(30, 0),
+    S(50, 0),     S(70, 0),     S(90, 0),     S(120, 0),    S(150, 0),
+    S(180, 0),    S(220, 0),    S(260, 0),    S(300, 0),    S(350, 0),
+    S(390, 0),    S(440, 0),    S(500, 0),    S(560, 0),    S(620, 0),
+    S(680, 0),    S(750, 0),    S(820, 0),    S(850, 1),    S(890, 1),
+    S(970, 2),    S(1050, 3),   S(1130, 4),   S(1220, 5),   S(1310, 6),
+    S(1400, 8),   S(1500, 10),  S(1690, 13),  S(1800, 16),  S(1910, 20),
+    S(2020, 25),  S(2130, 30),  S(2250, 36),  S(2370, 42),  S(2480, 48),
+    S(2600, 55),  S(2720, 62),  S(2830, 70),  S(2950, 80),  S(3070, 90),
+    S(3190, 90),  S(3300, 90),  S(3420, 90),  S(3540, 90),  S(3660, 90),
+    S(3770, 90),  S(3890, 90),  S(4010, 90),  S(4120, 90),  S(4240, 90),
+    S(4360, 90),  S(4480, 90),  S(4590, 90),  S(4710, 90),  S(4830, 90),
+    S(4940, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),
+    S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),
+    S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),
+    S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),
+    S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),
+    S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),
+    S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),
+    S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90),  S(5000, 90)
 };
 
 /* Pawn Specific Values {Mid game, End game} */
 
-const i32 PawnHangingPenalty[2] = { -10, 0 };
+const Score PawnHangingPenalty = S(-10, 0);
 
-const i32 DoubledPawnPenalty[2] = { -20, -200 };
+const Score DoubledPawnPenalty = S(-20, -200);
 
-const i32 IsolatedPawnPenalty[2] = { -50, -100 };
+const Score IsolatedPawnPenalty = S(-50, -100);
 
-const i32 RammedPawnPenalty[2] = { -20, -100 };
+const Score RammedPawnPenalty = S(-20, -100);
 
-const i32 PassedPawnBonus[2] = { 25, 500 };
+const Score PassedPawnBonus = S(25, 500);
 
-const i32 ConnectedPawnBonus[2] = { 20, 60 };
+const Score ConnectedPawnBonus = S(20, 60);
 
 /* Knight Specific Values {Mid game, End game} */
 
-const i32 KnightHangingPenalty[2] =  { -20, 0 };
+const Score KnightHangingPenalty = S(-20, 0);
 
-const i32 KnightMobility[2][9] = 
-{
-    {  -104,  -45,  -22,  -8,  6,  11,  19,  30,  43 },
-    { -1040, -450, -220, -80, 60, 110, 190, 300, 430 }
+const Score KnightMobility[9] = {
+    S(-104, -1040),  S(-45, -450),    S(-22, -220),    S(-8, -80),      S(6, 60),
+    S(11, 110),      S(19, 190),      S(30, 300),      S(43, 430)
 };
 
-const i32 OutpostKnightBonus[2] = { 50, 0 };
+const Score OutpostKnightBonus = S(50, 0);
 
-const i32 OutpostKnightExtraBonus[2] = { 100, 0 };
+const Score OutpostKnightExtraBonus = S(100, 0);
 
 /* Bishop Specific Values */
 
-const i32 BishopHangingPenalty[2] = { -10, 0 };
+const Score BishopHangingPenalty = S(-10, 0);
 
-const i32 BishopMobility[2][14] = 
-{
-    {  -99,  -46,  -16,  -4,  6,  14,  17,  19,  19 , 27 , 26,  52,  55,  83 },
-    { -990, -460, -160, -40, 60, 140, 170, 190, 190, 270, 260, 520, 550, 830 },
+const Score BishopMobility[14] = {
+    S(-99, -990),  S(-46, -460),  S(-16, -160),  S(-4, -40),    S(6, 60),      S(14, 140),    S(17, 170),
+    S(19, 190),    S(19, 190),    S(27, 270),    S(26, 260),    S(52, 520),    S(55, 550),    S(83, 830)
 };
 
-const i32 OutpostBishopBonus[2] = { 25, 0 };
+const Score OutpostBishopBonus = S(25, 0);
 
-const i32 OutpostBishopExtraBonus[2] = { 30, 0 };
+const Score OutpostBishopExtraBonus = S(30, 0);
 
-const i32 OppositeBishopBonus[2] = { 75, 300 };
+const Score OppositeBishopBonus = S(75, 300);
 
-const i32 BishopPawnWeakPenalty[2] = { -75, 0 };
+const Score BishopPawnWeakPenalty = S(-75, 0);
 
 /* Rook Specific Values */
 
-const i32 RookHangingPenalty[2] = { -15, 0 };
+const Score RookHangingPenalty = S(-15, 0);
 
-const i32 RookMobility[2][15] = 
-{
-    {  -127,  -56,  -25,  -12,  -10,  -12,  -11,  -4,  4,  9,  11,  19,  19,  37,  97 },
-    { -1270, -560, -250, -120, -100, -120, -110, -40, 40, 90, 110, 190, 190, 370, 970 },
+const Score RookMobility[15] = {
+    S(-127, -1270),  S(-56, -560),    S(-25, -250),    S(-12, -120),    S(-10, -100),
+    S(-12, -120),    S(-11, -110),    S(-4, -40),      S(4, 40),        S(9, 90),
+    S(11, 110),      S(19, 190),      S(19, 190),      S(37, 370),      S(97, 970)
 };
 
-const i32 ConnectedRookBonus[2] = { 15, 0 };
+const Score ConnectedRookBonus = S(15, 0);
 
-const i32 TwoRookPenalty[2] = { -5, -35 };
+const Score TwoRookPenalty = S(-5, -35);
 
 /* Queen Specific Values */
 
-const i32 QueenHangingPenalty[2] = { -60, 0 };
+const Score QueenHangingPenalty = S(-60, 0);
 
-const i32 QueenMobility[2][28] = 
-{
-    {
-        -111, -111, -104, -46, -20, -9, -1,  2,  8, 10, 15, 17,  20,  23,
-        22,   21,   24,  16,  13, 18, 25, 38, 34, 28, 10,  7, -42, -23,
-    },
-    {
-        -1110, -2530, -1270, -460, -200, -90, -10,  20,  80, 100, 150, 170,  200,  230,
-        220,   210,   240,  160,  130, 180, 250, 380, 340, 280, 100,  70, -420, -230,
-    },
+const Score QueenMobility[28] = {
+    S(-111, -1110),  S(-111, -2530),  S(-104, -1270),  S(-46, -460),    S(-20, -200),
+    S(-9, -90),      S(-1, -10),      S(2, 20),        S(8, 80),        S(10, 100),
+    S(15, 150),      S(17, 170),      S(20, 200),      S(23, 230),      S(22, 220),
+    S(21, 210),      S(24, 240),      S(16, 160),      S(13, 130),      S(18, 180),
+    S(25, 250),      S(38, 380),      S(34, 340),      S(28, 280),      S(10, 100),
+    S(7, 70),        S(-42, -420),    S(-23, -230)
 };
 
-const i32 QueenPinPenalty[2] = { -100, -300};
+const Score QueenPinPenalty = S(-100, -300);
 
 /* Positional Values */
-const i32 CastleAbilityBonus[2] = { 0, 0 };
+const Score CastleAbilityBonus = S(0, 0);
 
+#ifdef RUNTIME_TABLES
+/*
+ * Packs the mg and eg rows of each piece table into one Score per square, black reads them mirrored
+ */
 void init_pst(){
     for (int i = 0; i < 64; i++) {
-        for(int phase = 0; phase < 2; phase++){
-            // Pawn
-            PST[phase][WHITE_PAWN][i]        = PSTPawn[phase][i];
-            PST[phase][BLACK_PAWN][63 - i]   = PSTPawn[phase][i];
-            // Knight
-            PST[phase][WHITE_KNIGHT][i]      = PSTKnight[phase][i];
-            PST[phase][BLACK_KNIGHT][63 - i] = PSTKnight[phase][i];
-            // Bishop
-            PST[phase][WHITE_BISHOP][i]      = PSTBishop[phase][i];
-            PST[phase][BLACK_BISHOP][63 - i] = PSTBishop[phase][i];
-            // Rook
-            PST[phase][WHITE_ROOK][i]        = PSTRook[phase][i];
-            PST[phase][BLACK_ROOK][63 - i]   = PSTRook[phase][i];
-            // Queen
-            PST[phase][WHITE_QUEEN][i]       = PSTQueen[phase][i];
-            PST[phase][BLACK_QUEEN][63 - i]  = PSTQueen[phase][i];
-            // King
-            PST[phase][WHITE_KING][i]        = PSTKing[phase][i];
-            PST[phase][BLACK_KING][63 - i]   = PSTKing[phase][i];
-        }
+        // Pawn
+        PST[WHITE_PAWN][i]        = S(PSTPawn[PHASE_MG][i], PSTPawn[PHASE_EG][i]);
+        PST[BLACK_PAWN][63 - i]   = PST[WHITE_PAWN][i];
+        // Knight
+        PST[WHITE_KNIGHT][i]      = S(PSTKnight[PHASE_MG][i], PSTKnight[PHASE_EG][i]);
+        PST[BLACK_KNIGHT][63 - i] = PST[WHITE_KNIGHT][i];
+        // Bishop
+        PST[WHITE_BISHOP][i]      = S(PSTBishop[PHASE_MG][i], PSTBishop[PHASE_EG][i]);
+        PST[BLACK_BISHOP][63 - i] = PST[WHITE_BISHOP][i];
+        // Rook
+        PST[WHITE_ROOK][i]        = S(PSTRook[PHASE_MG][i], PSTRook[PHASE_EG][i]);
+        PST[BLACK_ROOK][63 - i]   = PST[WHITE_ROOK][i];
+        // Queen
+        PST[WHITE_QUEEN][i]       = S(PSTQueen[PHASE_MG][i], PSTQueen[PHASE_EG][i]);
+        PST[BLACK_QUEEN][63 - i]  = PST[WHITE_QUEEN][i];
+        // King
+        PST[WHITE_KING][i]        = S(PSTKing[PHASE_MG][i], PSTKing[PHASE_EG][i]);
+        PST[BLACK_KING][63 - i]   = PST[WHITE_KING][i];
+    }
+}
+
+/*
+ * Adds the most one term can raise and lower a side's score, in each phase, times how often a piece can apply it
+ */
+static void bound_term(PieceType type, const Score* table, i32 size, i32 times){
+    i32 max_mg = 0, min_mg = 0, max_eg = 0, min_eg = 0;
+    for(i32 i = 0; i < size; i++){
+        max_mg = MAX(max_mg, mg_value(table[i]));
+        min_mg = MIN(min_mg, mg_value(table[i]));
+        max_eg = MAX(max_eg, eg_value(table[i]));
+        min_eg = MIN(min_eg, eg_value(table[i]));
+    }
+    LazyGain[type] += S(max_mg * times, max_eg * times);
+    LazyLoss[type] += S(-min_mg * times, -min_eg * times);
+}
+
+/*
+ * Bounds, per piece, every term evaluate() skips when it stops after the cheap stage
+ * Terms applied once per side are bounded per piece, which only makes the margin safer
+ */
+void init_lazy_margins(){
+    Score knight_adjust[9], rook_adjust[9], safety[100], pawns_in_king_area[9];
+    for(i32 i = 0; i < 9; i++){
+        knight_adjust[i] = S(KnightAdjust[i], KnightAdjust[i]);
+        rook_adjust[i]   = S(RookAdjust[i], RookAdjust[i]);
+        pawns_in_king_area[i] = S(mg_value(PawnsInKingArea[i]), 0);
     }
+    for(i32 i = 0; i < 100; i++) safety[i] = -SafetyTable[i];
+    memset(LazyGain, 0, sizeof(LazyGain));
+    memset(LazyLoss, 0, sizeof(LazyLoss));
+
+    bound_term(PAWN, &PawnHangingPenalty, 1, 1);
+
+    bound_term(KNIGHT, knight_adjust, 9, 1);
+    bound_term(KNIGHT, KnightMobility, 9, 1);
+    bound_term(KNIGHT, &OutpostKnightBonus, 1, 1);
+    bound_term(KNIGHT, &OutpostKnightExtraBonus, 1, 1);
+    bound_term(KNIGHT, &KnightHangingPenalty, 1, 1);
+
+    bound_term(BISHOP, BishopMobility, 14, 1);
+    bound_term(BISHOP, &BishopPawnWeakPenalty, 1, 1);
+    bound_term(BISHOP, &OppositeBishopBonus, 1, 1);
+    bound_term(BISHOP, &OutpostBishopBonus, 1, 1);
+    bound_term(BISHOP, &OutpostBishopExtraBonus, 1, 1);
+    bound_term(BISHOP, &BishopHangingPenalty, 1, 1);
+
+    bound_term(ROOK, rook_adjust, 9, 1);
+    bound_term(ROOK, RookMobility, 15, 1);
+    bound_term(ROOK, &ConnectedRookBonus, 1, 1);
+    bound_term(ROOK, &TwoRookPenalty, 1, 1);
+    bound_term(ROOK, &RookHangingPenalty, 1, 1);
+
+    bound_term(QUEEN, QueenMobility, 28, 1);
+    bound_term(QUEEN, &QueenHangingPenalty, 1, 1);
+
+    bound_term(KING, &OpenFileNearKingPenalty, 1, 3); // Once for each file next to and under the king
+    bound_term(KING, pawns_in_king_area, 9, 1);
+    bound_term(KING, VirtualMobility, 28, 1);
+    bound_term(KING, safety, 100, 1);
 }
+#endif
 
 /* Returns a material-only based evaluation */
 i32 eval_material(Position* pos){
-    i32 eval = 0;
     Turn turn = pos->flags & TURN_MASK;
-    eval += KingValue   * (count_bits(pos->king[turn])   - count_bits(pos->king[!turn]));
-    eval += QueenValue  * (count_bits(pos->queen[turn])  - count_bits(pos->queen[!turn]));
-    eval += RookValue   * (count_bits(pos->rook[turn])   - count_bits(pos->rook[!turn]));
-    eval += BishopValue * (count_bits(pos->bishop[turn]) - count_bits(pos->bishop[!turn]));
-    eval += KnightValue * (count_bits(pos->knight[turn]) - count_bits(pos->knight[!turn]));
-    eval += PawnValue   * (count_bits(pos->pawn[turn])   - count_bits(pos->pawn[!turn]));
-    return eval;
+    return pos->accum.material[turn] - pos->accum.material[!turn];
 };
 
+/*
+ * Sums every piece into a fresh accumulator, makeMove keeps it up to date from here on
+ */
+EvalAccum init_eval_accum(const Position* pos){
+    EvalAccum accum = {0};
+    for(i32 square = 0; square < 64; square++){
+        if(pos->board[square] != NO_PIECE) accum_add_piece(&accum, pos->board[square], square);
+    }
+    return accum;
+}
+
 
-void init_eval_data(Position * pos, EvalData* eval_data, Turn turn){
+static void init_eval_data(Position * pos, EvalData* eval_data, Turn turn){
     // Get the saftey region for the king
-    eval_data->king_area[turn] = KingAreaMask[getlsb(pos->king[turn])];
+    eval_data->king_area[turn] = KingAreaMask[getlsb(pos->pieces[turn][KING])];
 }
 
-void eval_pawns(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_PAWN : BLACK_PAWN;
-    eval_data->pawn_count[turn] = 0;
-
+/*
+ * Pawn only terms of one side, everything here depends on nothing but the pawns of both sides
+ */
+static void eval_pawn_structure(Position * pos, PawnHashEntry* entry, Turn turn){
     // Iterate through the pawns
-    u64 pieces = pos->pawn[turn];
+    u64 pieces = pos->pieces[turn][PAWN];
     while (pieces) {
         i32 square = getlsb(pieces);
         u32 file = square % 8;
         u32 promo_square = turn ? A8 + file : A1 + file;
-        u64 attacks = pawnAttacks(square, turn);
-
-        // Material Value
-        eval_data->eval[PHASE_MG][turn] += PawnValue;
-        eval_data->eval[PHASE_EG][turn] += PawnValue;
-
-        // PST
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
 
         // Passed Pawn Bonus
-        if((PassedPawnMask[turn][square] & pos->pawn[!turn])){
-            eval_data->eval[PHASE_MG][turn] += PassedPawnBonus[PHASE_MG];
-            eval_data->eval[PHASE_EG][turn] += PassedPawnBonus[PHASE_EG];
+        if((PassedPawnMask[turn][square] & pos->pieces[!turn][PAWN])){
+            entry->score[turn] += PassedPawnBonus;
         }
 
         // Doubled Pawn Penalty
         // Applied for the pawn in the back
-        if(!(betweenMask[square][promo_square] & pos->pawn[turn])){
-            eval_data->eval[PHASE_MG][turn] += DoubledPawnPenalty[PHASE_MG];
-            eval_data->eval[PHASE_EG][turn] += DoubledPawnPenalty[PHASE_EG];
+        if(!(betweenMask[square][promo_square] & pos->pieces[turn][PAWN])){
+            entry->score[turn] += DoubledPawnPenalty;
         }
 
         // Isolated pawn penalty
         // When there are no pawns on either of the neighboring files
-        if(     ( file == 0 && !(fileMask[file + 1] & pos->pawn[turn]) )
-            ||  ( file == 7 && !(fileMask[file - 1] & pos->pawn[turn]) )
-            ||  ( !(fileMask[file + 1] & pos->pawn[turn] || fileMask[file - 1] & pos->pawn[turn]) ) ){
-            eval_data->eval[PHASE_MG][turn] += IsolatedPawnPenalty[PHASE_MG];
-            eval_data->eval[PHASE_EG][turn] += IsolatedPawnPenalty[PHASE_EG];
+        if(     ( file == 0 && !(fileMask[file + 1] & pos->pieces[turn][PAWN]) )
+            ||  ( file == 7 && !(fileMask[file - 1] & pos->pieces[turn][PAWN]) )
+            ||  ( !(fileMask[file + 1] & pos->pieces[turn][PAWN] || fileMask[file - 1] & pos->pieces[turn][PAWN]) ) ){
+            entry->score[turn] += IsolatedPawnPenalty;
         }
 
-        // Update King saftey data
-        eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & attacks) * ATTACK_UNIT_PAWN;
-
-        // Update evaluation data
-        eval_data->pawn_attacks[turn] |= attacks;
-        eval_data->pawn_count[turn]++;
         if(is_square_light(square))
-            eval_data->light_pawn_count[turn]++;
+            entry->light_pawn_count[turn]++;
         else
-            eval_data->dark_pawn_count[turn]++;
+            entry->dark_pawn_count[turn]++;
 
         pieces &= pieces - 1;
     }
 
+    // Attacks toward each side, every pawn adds at most one square to each set
+    pieces = pos->pieces[turn][PAWN];
+    entry->attacks_west[turn] = turn ? noWeOne(pieces) : soWeOne(pieces);
+    entry->attacks_east[turn] = turn ? noEaOne(pieces) : soEaOne(pieces);
+
     // Count the rammed pawns by shifting the pawn bitboard one move
     // forward relative to the pawn type and comparing with enemy pawns
     // we dont need to use masks because pawns cant be on those rows
-    pieces = pos->pawn[turn];
     pieces = turn ? northOne(pieces) : southOne(pieces);
-    i32 rammed_cnt = count_bits(pieces & pos->pawn[!turn]);
-    eval_data->eval[PHASE_MG][turn] += rammed_cnt * RammedPawnPenalty[PHASE_MG];
-    eval_data->eval[PHASE_EG][turn] += rammed_cnt * RammedPawnPenalty[PHASE_EG];
+    i32 rammed_cnt = count_bits(pieces & pos->pieces[!turn][PAWN]);
+    entry->score[turn] += rammed_cnt * RammedPawnPenalty;
 
     // Bonus for connected pawns
     // Calculate from looking at the pawns that attack friendly pawns
-    i32 connected_cnt = count_bits(eval_data->pawn_attacks[turn] & pos->pawn[turn]);
-    eval_data->eval[PHASE_MG][turn] += connected_cnt * ConnectedPawnBonus[PHASE_MG];
-    eval_data->eval[PHASE_EG][turn] += connected_cnt * ConnectedPawnBonus[PHASE_EG];
+    i32 connected_cnt = count_bits((entry->attacks_west[turn] | entry->attacks_east[turn]) & pos->pieces[turn][PAWN]);
+    entry->score[turn] += connected_cnt * ConnectedPawnBonus;
+}
 
-    // Penalty for hanging pawns
-    i32 hanging_cnt = count_bits(~pos->attack_mask[turn] & pos->pawn[turn]);
-    eval_data->eval[PHASE_MG][turn] += hanging_cnt * PawnHangingPenalty[PHASE_MG];
-    eval_data->eval[PHASE_EG][turn] += hanging_cnt * PawnHangingPenalty[PHASE_EG];
+/*
+ * The pawn only terms of both sides, from the pawn hash table of this thread when it can
+ */
+static PawnHashEntry* probe_pawns(Position * pos){
+    PawnHashEntry* entry = &pawn_table[pos->pawn_hash & (PAWN_HASH_ENTRIES - 1)];
+    pawn_probes++;
+    if(entry->key == pos->pawn_hash){
+        pawn_hits++;
+    }
+    else {
+        memset(entry, 0, sizeof(PawnHashEntry));
+        entry->key = pos->pawn_hash;
+        eval_pawn_structure(pos, entry, WHITE);
+        eval_pawn_structure(pos, entry, BLACK);
+    }
+    return entry;
+}
 
-    return;
+/*
+ * Pawn terms of both sides that depend on more than the pawns, the entry's own score is already added
+ */
+static void eval_pawns(Position * pos, EvalData* eval_data, PawnHashEntry* entry){
+    for(Turn turn = BLACK; turn <= WHITE; turn++){
+        // Update evaluation data
+        eval_data->pawn_attacks[turn] = entry->attacks_west[turn] | entry->attacks_east[turn];
+        eval_data->light_pawn_count[turn] = entry->light_pawn_count[turn];
+        eval_data->dark_pawn_count[turn] = entry->dark_pawn_count[turn];
+        eval_data->pawn_count[turn] = entry->light_pawn_count[turn] + entry->dark_pawn_count[turn];
+
+        // Update King saftey data, it depends on where the enemy king stands so it is not cached
+        // Counting both directions separately counts each pawn attacking into the area like a per pawn loop would
+        u64 king_area = eval_data->king_area[!turn];
+        eval_data->attack_units[turn] += (count_bits(king_area & entry->attacks_west[turn])
+                                        + count_bits(king_area & entry->attacks_east[turn])) * ATTACK_UNIT_PAWN;
+
+        // Penalty for hanging pawns
+        i32 hanging_cnt = count_bits(~getAttackMask(pos, turn) & pos->pieces[turn][PAWN]);
+        eval_data->score[turn] += hanging_cnt * PawnHangingPenalty;
+    }
 }
 
-void eval_knights(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_KNIGHT : BLACK_KNIGHT;
+/*
+ * Pawn hash counters of the calling thread
+ */
+CacheStats pawn_hash_stats(void){
+    CacheStats stats;
+    stats.probes = pawn_probes;
+    stats.hits   = pawn_hits;
+    return stats;
+}
+
+void pawn_hash_reset_stats(void){
+    pawn_probes = pawn_hits = 0;
+}
 
+static void eval_knights(Position * pos, EvalData* eval_data, Turn turn){
     // Update evaluation attack mask
-    eval_data->knight_attacks[turn] = getKnightAttacks(pos->knight[turn]);
+    eval_data->knight_attacks[turn] = getKnightAttacks(pos->pieces[turn][KNIGHT]);
    
-    u64 pieces = pos->knight[turn];
+    u64 pieces = pos->pieces[turn][KNIGHT];
     while (pieces) {
         i32 square = getlsb(pieces);
 
-        // Knight material value
-        // Changes with the number of pawns we have
-        eval_data->eval[PHASE_MG][turn] += KnightValue + KnightAdjust[eval_data->pawn_count[turn]];
-        eval_data->eval[PHASE_EG][turn] += KnightValue + KnightAdjust[eval_data->pawn_count[turn]];
-
-        // PST Values
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
+        // Knight material value changes with the number of pawns we have
+        // the base value and PST are already in the accumulators
+        eval_data->score[turn] += S(KnightAdjust[eval_data->pawn_count[turn]], KnightAdjust[eval_data->pawn_count[turn]]);
 
         // Calculate the knight mobility by looking at
         // where it can move thats not under attack by opponenet
         // first we filter out moves where it attacks friendly
         // and then and it with the inverse opponent attack mask
         u64 knight_moves = knightAttacks(square) & ~pos->color[turn];
-        i32 mobility = count_bits(knight_moves & ~pos->attack_mask[!turn]);
-        eval_data->eval[PHASE_MG][turn] += KnightMobility[PHASE_MG][mobility];
-        eval_data->eval[PHASE_EG][turn] += KnightMobility[PHASE_EG][mobility];
+        i32 mobility = count_bits(knight_moves & ~getAttackMask(pos, !turn));
+        eval_data->score[turn] += KnightMobility[mobility];
 
         // Update King saftey data
         eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & knight_moves) * ATTACK_UNIT_KNIGHT;
 
-        // Update the phase
-        eval_data->phase_value += MINOR_PHASE;
-
         pieces &= pieces - 1;
     }
 
     // Knight outpost bonus
     // it an outpost if not attacked by enemy pawns
     // and is in an outpost square, bonus for knights protected by pawn
-    u64 outpost_knights = pos->knight[turn] & ~eval_data->pawn_attacks[!turn] & KnightOutpostMask[turn];
+    u64 outpost_knights = pos->pieces[turn][KNIGHT] & ~eval_data->pawn_attacks[!turn] & KnightOutpostMask[turn];
     i32 outpost_count = count_bits(outpost_knights);
     i32 extra_outpost_count = count_bits(outpost_knights & eval_data->pawn_attacks[turn]);
 
-    eval_data->eval[PHASE_MG][turn] += OutpostKnightBonus[PHASE_MG] * outpost_count;
-    eval_data->eval[PHASE_EG][turn] += OutpostKnightBonus[PHASE_EG] * outpost_count;
+    eval_data->score[turn] += OutpostKnightBonus * outpost_count;
 
-    eval_data->eval[PHASE_MG][turn] += OutpostKnightExtraBonus[PHASE_MG] * extra_outpost_count;
-    eval_data->eval[PHASE_EG][turn] += OutpostKnightExtraBonus[PHASE_EG] * extra_outpost_count;
+    eval_data->score[turn] += OutpostKnightExtraBonus * extra_outpost_count;
 
     // Penalty for hanging knights
-    i32 handing_cnt = count_bits(~pos->attack_mask[turn] & pos->knight[turn]);
-    eval_data->eval[PHASE_MG][turn] += KnightHangingPenalty[PHASE_MG] * handing_cnt;
-    eval_data->eval[PHASE_EG][turn] += KnightHangingPenalty[PHASE_EG] * handing_cnt;
+    i32 handing_cnt = count_bits(~getAttackMask(pos, turn) & pos->pieces[turn][KNIGHT]);
+    eval_data->score[turn] += KnightHangingPenalty * handing_cnt;
 
     return;
 }
 
-void eval_bishops(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_BISHOP : BLACK_BISHOP;
+static void eval_bishops(Position * pos, EvalData* eval_data, Turn turn){
     i32 light_bishops = 0, dark_bishops = 0;
 
     // Update evaluation attack mask
-    eval_data->bishop_attacks[turn] = getBishopAttacks(pos->bishop[turn], pos->color[turn], pos->color[!turn]);
+    eval_data->bishop_attacks[turn] = getBishopAttacks(pos->pieces[turn][BISHOP], pos->color[turn], pos->color[!turn]);
     
-    u64 pieces = pos->bishop[turn];
+    u64 pieces = pos->pieces[turn][BISHOP];
     while (pieces) {
         i32 square = getlsb(pieces);
 
-        // Material Value
-        eval_data->eval[PHASE_MG][turn] += BishopValue;
-        eval_data->eval[PHASE_EG][turn] += BishopValue;
-
-        // PST Values
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
         // Calculate the bishop mobility by looking at
         // where it can move thats not under attack by opponenet
         // first we filter out moves where it attacks friendly
         // and then and it with the inverse opponent attack mask
         u64 bishop_moves = bishopAttacks(pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
-        i32 mobility = count_bits(bishop_moves & ~pos->attack_mask[!turn]);
-        eval_data->eval[PHASE_MG][turn] += BishopMobility[PHASE_MG][mobility];
-        eval_data->eval[PHASE_EG][turn] += BishopMobility[PHASE_EG][mobility];
+        i32 mobility = count_bits(bishop_moves & ~getAttackMask(pos, !turn));
+        eval_data->score[turn] += BishopMobility[mobility];
         
         // Here we do some square color evaluation,
         // if the bishop is on the same square as a majority
@@ -540,158 +665,115 @@ void eval_bishops(Position * pos, EvalData* eval_data, Turn turn){
         if(is_square_light(square)){
             light_bishops++;
             if(eval_data->light_pawn_count[turn] > eval_data->dark_pawn_count[turn] + 1){
-                eval_data->eval[PHASE_MG][turn] += BishopPawnWeakPenalty[PHASE_MG];
-                eval_data->eval[PHASE_EG][turn] += BishopPawnWeakPenalty[PHASE_EG];
+                eval_data->score[turn] += BishopPawnWeakPenalty;
             }
         }
         else{
             dark_bishops++;
             if(eval_data->dark_pawn_count[turn] > eval_data->light_pawn_count[turn] + 1){
-                eval_data->eval[PHASE_MG][turn] += BishopPawnWeakPenalty[PHASE_MG];
-                eval_data->eval[PHASE_EG][turn] += BishopPawnWeakPenalty[PHASE_EG];
+                eval_data->score[turn] += BishopPawnWeakPenalty;
             }
         }
 
         // Update King saftey data
         eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & bishop_moves) * ATTACK_UNIT_BISHOP;
 
-        // Update the phase
-        eval_data->phase_value += MINOR_PHASE;
-
         pieces &= pieces - 1;
     }
 
     // Give a bonus if there are bishops on opposite colors
     if (light_bishops >= 1 && dark_bishops >= 1){
-        eval_data->eval[PHASE_MG][turn] += OppositeBishopBonus[PHASE_MG];
-        eval_data->eval[PHASE_EG][turn] += OppositeBishopBonus[PHASE_EG];
+        eval_data->score[turn] += OppositeBishopBonus;
     } 
 
     // Bishop outpost bonus
     // it an outpost if not attacked by enemy pawns
     // and is in an outpost square, bonus for knights protected by pawn
-    u64 outpost_bishops = pos->bishop[turn] & ~eval_data->pawn_attacks[!turn] & BishopOutpostMask[turn];
+    u64 outpost_bishops = pos->pieces[turn][BISHOP] & ~eval_data->pawn_attacks[!turn] & BishopOutpostMask[turn];
     i32 outpost_cnt = count_bits(outpost_bishops);
     i32 extra_outpost_cnt = count_bits(outpost_bishops & eval_data->pawn_attacks[turn]);
-    eval_data->eval[PHASE_MG][turn] += OutpostBishopBonus[PHASE_MG] * outpost_cnt;
-    eval_data->eval[PHASE_EG][turn] += OutpostBishopBonus[PHASE_EG] * outpost_cnt;
-    eval_data->eval[PHASE_MG][turn] += OutpostBishopExtraBonus[PHASE_MG] * extra_outpost_cnt;
-    eval_data->eval[PHASE_EG][turn] += OutpostBishopExtraBonus[PHASE_EG] * extra_outpost_cnt;
+    eval_data->score[turn] += OutpostBishopBonus * outpost_cnt;
+    eval_data->score[turn] += OutpostBishopExtraBonus * extra_outpost_cnt;
 
     // Penalty for hanging bishops
-    i32 hanging_cnt = count_bits(~pos->attack_mask[turn] & pos->bishop[turn]);
-    eval_data->eval[PHASE_MG][turn] += BishopHangingPenalty[PHASE_MG] * hanging_cnt;
-    eval_data->eval[PHASE_EG][turn] += BishopHangingPenalty[PHASE_EG] * hanging_cnt;
+    i32 hanging_cnt = count_bits(~getAttackMask(pos, turn) & pos->pieces[turn][BISHOP]);
+    eval_data->score[turn] += BishopHangingPenalty * hanging_cnt;
 
     return;
 }
 
-void eval_rooks(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_ROOK : BLACK_ROOK;
-
+static void eval_rooks(Position * pos, EvalData* eval_data, Turn turn){
     // Update evaluation attack mask
-    eval_data->rook_attacks[turn] = getRookAttacks(pos->rook[turn], pos->color[turn], pos->color[!turn]);
+    eval_data->rook_attacks[turn] = getRookAttacks(pos->pieces[turn][ROOK], pos->color[turn], pos->color[!turn]);
 
     // PST Values
-    u64 pieces = pos->rook[turn];
+    u64 pieces = pos->pieces[turn][ROOK];
     while (pieces) {
         i32 square = getlsb(pieces);
 
-        // Rook material value
-        // Changes with the number of pawns we have
-        eval_data->eval[PHASE_MG][turn] += RookValue + RookAdjust[eval_data->pawn_count[turn]];
-        eval_data->eval[PHASE_EG][turn] += RookValue + RookAdjust[eval_data->pawn_count[turn]];
-
-        // PST Values
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
+        // Rook material value changes with the number of pawns we have
+        // the base value and PST are already in the accumulators
+        eval_data->score[turn] += S(RookAdjust[eval_data->pawn_count[turn]], RookAdjust[eval_data->pawn_count[turn]]);
 
         // Calculate the rook mobility by looking at
         // where it can move thats not under attack by opponenet
         u64 rook_moves = rookAttacks(pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
-        i32 mobility = count_bits(rook_moves & ~pos->attack_mask[!turn]);
-        eval_data->eval[PHASE_MG][turn] += RookMobility[PHASE_MG][mobility];
-        eval_data->eval[PHASE_EG][turn] += RookMobility[PHASE_EG][mobility];
+        i32 mobility = count_bits(rook_moves & ~getAttackMask(pos, !turn));
+        eval_data->score[turn] += RookMobility[mobility];
 
         // Update King saftey data
         eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & rook_moves) * ATTACK_UNIT_ROOK;
 
-        // Update the phase
-        eval_data->phase_value += ROOK_PHASE;
-
         pieces &= pieces - 1;
     }
 
     // Connected Rook Bonus
     // Given if one of the rooks is attacking the other
-    if(count_bits(eval_data->rook_attacks[turn] & pos->rook[turn]) >= 2){
-        eval_data->eval[PHASE_MG][turn] += ConnectedRookBonus[PHASE_MG];
-        eval_data->eval[PHASE_EG][turn] += ConnectedRookBonus[PHASE_EG];
+    if(count_bits(eval_data->rook_attacks[turn] & pos->pieces[turn][ROOK]) >= 2){
+        eval_data->score[turn] += ConnectedRookBonus;
     }
 
     // Double Rook Penalty
     // having two rooks is not that great or something not sure abt this one
-    if (count_bits(pos->rook[turn]) >= 2){
-        eval_data->eval[PHASE_MG][turn] += TwoRookPenalty[PHASE_MG];
-        eval_data->eval[PHASE_EG][turn] += TwoRookPenalty[PHASE_EG];
+    if (count_bits(pos->pieces[turn][ROOK]) >= 2){
+        eval_data->score[turn] += TwoRookPenalty;
     }
 
     // Penalty for hanging rooks
-    i32 hanging_cnt = count_bits(~pos->attack_mask[turn] & pos->rook[turn]);
-    eval_data->eval[PHASE_MG][turn] += RookHangingPenalty[PHASE_MG] * hanging_cnt;
-    eval_data->eval[PHASE_EG][turn] += RookHangingPenalty[PHASE_EG] * hanging_cnt;
+    i32 hanging_cnt = count_bits(~getAttackMask(pos, turn) & pos->pieces[turn][ROOK]);
+    eval_data->score[turn] += RookHangingPenalty * hanging_cnt;
 
     return;
 }
 
-void eval_queens(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_QUEEN : BLACK_QUEEN;
-    
-    u64 pieces = pos->queen[turn];
+static void eval_queens(Position * pos, EvalData* eval_data, Turn turn){
+    u64 pieces = pos->pieces[turn][QUEEN];
     while (pieces) {
         i32 square = getlsb(pieces);
 
-        // Material Value
-        eval_data->eval[PHASE_MG][turn] += QueenValue;
-        eval_data->eval[PHASE_EG][turn] += QueenValue;
-
-        // PST Values
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
         // Calculate the queen mobility by looking at
         // where it can move thats not under attack by opponenet
         u64 queen_moves  = rookAttacks(  pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
             queen_moves |= bishopAttacks(pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
-        eval_data->eval[PHASE_MG][turn] += QueenMobility[PHASE_MG][count_bits(queen_moves & ~pos->attack_mask[!turn])];
-        eval_data->eval[PHASE_EG][turn] += QueenMobility[PHASE_EG][count_bits(queen_moves & ~pos->attack_mask[!turn])];
+        eval_data->score[turn] += QueenMobility[count_bits(queen_moves & ~getAttackMask(pos, !turn))];
 
         // Update King saftey data
         eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & queen_moves) * ATTACK_UNIT_QUEEN;
 
-        // Update the phase
-        eval_data->phase_value += QUEEN_PHASE;
-
         pieces &= pieces - 1;
     }
 
     // Penalty for hanging queens
-    i32 hanging_cnt = count_bits(~pos->attack_mask[turn] & pos->queen[turn]);
-    eval_data->eval[PHASE_MG][turn] += QueenHangingPenalty[PHASE_MG] * hanging_cnt;
-    eval_data->eval[PHASE_EG][turn] += QueenHangingPenalty[PHASE_EG] * hanging_cnt;
+    i32 hanging_cnt = count_bits(~getAttackMask(pos, turn) & pos->pieces[turn][QUEEN]);
+    eval_data->score[turn] += QueenHangingPenalty * hanging_cnt;
 
     return;
 }
 
-void eval_kings(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_KING : BLACK_KING;
-    const u32 square = getlsb(pos->king[turn]);
+static void eval_kings(Position * pos, EvalData* eval_data, Turn turn){
+    const u32 square = getlsb(pos->pieces[turn][KING]);
     i32 file = square % 8;
 
-    // PST Values
-    eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-    eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
     // Mobility
     i32 move_count = 0;
     getKingMoves(pos, turn, &move_count);
@@ -702,35 +784,103 @@ void eval_kings(Position * pos, EvalData* eval_data, Turn turn){
 
     // Penalty for when there are no pawns on a file near the king
     for(i32 i = MAX(0, file-1); i <= MIN(7, file+1); i++){
-        if(fileMask[file] & (pos->pawn[turn] | pos->pawn[!turn]) ){
-            eval_data->eval[PHASE_MG][turn] += OpenFileNearKingPenalty[PHASE_MG];
-            eval_data->eval[PHASE_EG][turn] += OpenFileNearKingPenalty[PHASE_EG];
+        if(fileMask[file] & (pos->pieces[turn][PAWN] | pos->pieces[!turn][PAWN]) ){
+            eval_data->score[turn] += OpenFileNearKingPenalty;
         } 
     }
 
     // King gets a bonus or a penalty for the
     // number of friendly pawns in its area
-    i32 pawns_near_cnt = count_bits(eval_data->king_area[turn] & pos->pawn[turn]);
-    eval_data->eval[PHASE_MG][turn] += PawnsInKingArea[PHASE_MG][pawns_near_cnt];
+    i32 pawns_near_cnt = count_bits(eval_data->king_area[turn] & pos->pieces[turn][PAWN]);
+    // Only the middle game half of this one is applied
+    eval_data->score[turn] += S(mg_value(PawnsInKingArea[pawns_near_cnt]), 0);
 
     // The king loses eval if its very susceptible to sliding attacks, to do this we
     // look at how it can move as a queen
     u64 virt_moves  = rookAttacks(  pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
         virt_moves |= bishopAttacks(pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
-    eval_data->eval[PHASE_MG][turn] += VirtualMobility[PHASE_MG][count_bits(virt_moves)];
-    eval_data->eval[PHASE_EG][turn] += VirtualMobility[PHASE_EG][count_bits(virt_moves)];
+    eval_data->score[turn] += VirtualMobility[count_bits(virt_moves)];
 
     // Saftey information from enemy pieces attacking the kings area
-    eval_data->eval[PHASE_MG][turn] -= SafetyTable[PHASE_MG][eval_data->attack_units[!turn]];
-    eval_data->eval[PHASE_EG][turn] -= SafetyTable[PHASE_EG][eval_data->attack_units[!turn]];
+    eval_data->score[turn] -= SafetyTable[eval_data->attack_units[!turn]];
 
     return;
 }
 
+/*
+ * Sets the size of every thread's eval cache, rounded down to a power of two, 0 turns the cache off
+ * The caches are freed here and reallocated as each thread binds, so no search may be running
+ */
+void set_eval_cache_size(u64 size_kb){
+    u64 entries = MIN(size_kb, EVAL_CACHE_MAX_KB) * 1024 / sizeof(EvalCacheEntry);
+    while(entries & (entries - 1)) entries &= entries - 1;
+    free_eval_caches();
+    eval_cache_entries = entries;
+}
+
+/*
+ * Points the calling thread at the cache of thread_num, allocating it on first use
+ * Each search thread calls this before it searches, a thread that never does evaluates uncached
+ */
+void bind_eval_cache(u32 thread_num){
+    EvalCache* cache = &eval_caches[thread_num % MAX_THREADS];
+    if(!cache->entries && eval_cache_entries){
+        cache->entries = calloc(eval_cache_entries, sizeof(EvalCacheEntry));
+        cache->mask = eval_cache_entries - 1;
+    }
+    eval_cache = cache->entries ? cache : NULL;
+}
+
+/*
+ * Starts loading the eval cache slot and pawn hash entry of a position the search is about to evaluate
+ */
+void prefetch_eval(const Position* pos){
+    if(eval_cache) PREFETCH(&eval_cache->entries[pos->hash & eval_cache->mask]);
+    PREFETCH(&pawn_table[pos->pawn_hash & (PAWN_HASH_ENTRIES - 1)]);
+}
+
+void free_eval_caches(void){
+    for(u32 i = 0; i < MAX_THREADS; i++){
+        free(eval_caches[i].entries);
+        eval_caches[i].entries = NULL;
+        eval_caches[i].mask = 0;
+    }
+}
+
+/*
+ * Counters summed over every thread's cache, only exact while no search is running
+ */
+CacheStats eval_cache_stats(void){
+    CacheStats stats = {0};
+    for(u32 i = 0; i < MAX_THREADS; i++){
+        stats.probes += eval_caches[i].probes;
+        stats.hits   += eval_caches[i].hits;
+    }
+    return stats;
+}
+
+void eval_cache_reset_stats(void){
+    for(u32 i = 0; i < MAX_THREADS; i++) eval_caches[i].probes = eval_caches[i].hits = 0;
+}
+
+/*
+ * Adds the most the terms after the cheap stage can move the score of one side, from its LazyGain or LazyLoss table
+ * Summed unpacked since many pieces could overflow a Score
+ */
+static inline void add_lazy_margin(Position * pos, Turn turn, const Score* table, i32* mg, i32* eg){
+    for(PieceType type = PAWN; type <= KING; type++){
+        i32 count = count_bits(pos->pieces[turn][type]);
+        *mg += count * mg_value(table[type]);
+        *eg += count * eg_value(table[type]);
+    }
+}
+
 /* 
  * Evaluates a position
+ * Stops after material, PST and pawn structure when the rest can't bring the eval inside (alpha, beta),
+ * it then returns the bound it proved and sets lazy
  */
-i32 eval_position(Position* pos){
+static i32 evaluate(Position* pos, i32 alpha, i32 beta, u8* lazy){
     i32 eval = 0;
     EvalData eval_data = {0};
     Turn turn = pos->flags & TURN_MASK;
@@ -738,58 +888,122 @@ i32 eval_position(Position* pos){
     // Check for insufficient material
     if(isInsufficient(pos)) return 0;
 
+    // Cheap stage, PST from the accumulators of the position and the pawn structure from the pawn hash table
+    PawnHashEntry* pawns = probe_pawns(pos);
+    eval_data.score[WHITE] = pos->accum.psqt[WHITE] + pawns->score[WHITE];
+    eval_data.score[BLACK] = pos->accum.psqt[BLACK] + pawns->score[BLACK];
+
+    i32 material = pos->accum.material[WHITE] - pos->accum.material[BLACK];
+    i32 mg_weight = MIN(pos->accum.phase_value, TOTAL_PHASE_VALUE);
+    i32 eg_weight = TOTAL_PHASE_VALUE - mg_weight;
+
+    if(alpha > MIN_EVAL || beta < MAX_EVAL){
+        Score cheap = eval_data.score[WHITE_TURN] - eval_data.score[BLACK_TURN];
+        i32 mg_score = mg_value(cheap) + material;
+        i32 eg_score = eg_value(cheap) + material;
+
+        // Most the skipped terms can raise and lower the eval for white, in each phase
+        i32 up_mg = 0, up_eg = 0, down_mg = 0, down_eg = 0;
+        add_lazy_margin(pos, WHITE, LazyGain, &up_mg, &up_eg);
+        add_lazy_margin(pos, BLACK, LazyLoss, &up_mg, &up_eg);
+        add_lazy_margin(pos, WHITE, LazyLoss, &down_mg, &down_eg);
+        add_lazy_margin(pos, BLACK, LazyGain, &down_mg, &down_eg);
+
+        // The interpolation only grows with its inputs, so interpolating the extremes bounds the full eval
+        i32 upper = (((mg_score + up_mg) * mg_weight) + ((eg_score + up_eg) * eg_weight)) / TOTAL_PHASE_VALUE;
+        i32 lower = (((mg_score - down_mg) * mg_weight) + ((eg_score - down_eg) * eg_weight)) / TOTAL_PHASE_VALUE;
+        if(!turn){
+            i32 white_upper = upper;
+            upper = -lower;
+            lower = -white_upper;
+        }
+        if(lower >= beta || upper <= alpha){
+            lazy_exits++;
+            *lazy = TRUE;
+            return lower >= beta ? lower : upper;
+        }
+    }
+
     // Set up the evaluation data structure
     init_eval_data(pos, &eval_data, WHITE);
     init_eval_data(pos, &eval_data, BLACK);
 
     // Evaluate pieces
-    eval_pawns(pos, &eval_data, WHITE);
-    eval_pawns(pos, &eval_data, BLACK);
-
-    // i32 print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // i32 print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
-    // printf("after pawns: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
+    eval_pawns(pos, &eval_data, pawns);
 
     eval_knights(pos, &eval_data, WHITE);
     eval_knights(pos, &eval_data, BLACK);
 
-    // print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
-    // printf("after knights: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
-
     eval_bishops(pos, &eval_data, WHITE);
     eval_bishops(pos, &eval_data, BLACK);
 
-    // print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
-    // printf("after bishops: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
-
     eval_rooks(pos, &eval_data, WHITE);
     eval_rooks(pos, &eval_data, BLACK);
 
-    // print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
-    // printf("after rooks: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
-
     eval_queens(pos, &eval_data, WHITE);
     eval_queens(pos, &eval_data, BLACK);
 
-    // print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
-    // printf("after queens: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
-
     eval_kings(pos, &eval_data, WHITE);
     eval_kings(pos, &eval_data, BLACK);
 
     /* Interpolate the evaluation based on the calculated game phase */
-    i32 mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    i32 eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
+    // Material is the same in both phases so it is only added back here
+    Score score = eval_data.score[WHITE_TURN] - eval_data.score[BLACK_TURN];
+    i32 mg_score = mg_value(score) + material;
+    i32 eg_score = eg_value(score) + material;
 
-    i32 mg_weight = MIN(eval_data.phase_value, TOTAL_PHASE_VALUE);
-    i32 eg_weight = TOTAL_PHASE_VALUE - mg_weight;
     eval += ((mg_score * mg_weight) + (eg_score * eg_weight)) / TOTAL_PHASE_VALUE;
 
     //printf("at the end: mg_score %d mg_wieght %d eg_score %d eg_weight %d\n", mg_score, mg_weight, eg_score, eg_weight);
     
     return turn ? eval : -eval;
+}
+
+/*
+ * Static evaluation from the side to move, served from the thread's eval cache when the position was seen before
+ * With a window narrower than [MIN_EVAL, MAX_EVAL] it may only return a bound outside of it, lazy is then set
+ */
+i32 eval_position(Position* pos, i32 alpha, i32 beta, u8* lazy){
+    EvalCacheEntry* cached = NULL;
+    u32 key = (u32)(pos->hash >> 32);
+    *lazy = FALSE;
+    eval_calls++;
+    if(eval_cache){
+        cached = &eval_cache->entries[pos->hash & eval_cache->mask];
+        eval_cache->probes++;
+        if(cached->key == key){
+            eval_cache->hits++;
+            return cached->eval;
+        }
+    }
+    i32 eval = evaluate(pos, alpha, beta, lazy);
+
+    #ifdef DEBUG
+    u8 full_lazy = FALSE;
+    i32 full_eval = *lazy ? evaluate(pos, MIN_EVAL, MAX_EVAL, &full_lazy) : eval;
+    if((eval >= beta && full_eval < eval) || (eval <= alpha && full_eval > eval)){
+        printf("WARNING LAZY EVAL BOUND %d DOES NOT HOLD FOR FULL EVAL %d IN WINDOW (%d, %d)\n", eval, full_eval, alpha, beta);
+        printPosition(*pos, TRUE);
+    }
+    #endif
+
+    if(cached && !*lazy){ // A bound is only good for the window it was made for
+        cached->key = key;
+        cached->eval = eval;
+    }
+    return eval;
+}
+
+/*
+ * Lazy eval counters of the calling thread
+ */
+LazyEvalStats lazy_eval_stats(void){
+    LazyEvalStats stats;
+    stats.calls = eval_calls;
+    stats.lazy  = lazy_exits;
+    return stats;
+}
+
+void lazy_eval_reset_stats(void){
+    eval_calls = lazy_exits = 0;
 }
\ No newline at end of file
@@ -3,10 +3,19 @@
 
 #define TRACE 0
 
-struct EvalData{
-    i32 eval[2][2];
+/* Phase Information */
+enum Phase{
+    PHASE_MG = 0,
+    PHASE_EG = 1,
+
+    MINOR_PHASE = 1,
+    ROOK_PHASE  = 2,
+    QUEEN_PHASE = 4,
+    TOTAL_PHASE_VALUE = 24
+};
 
-    i32 phase_value;
+struct EvalData{
+    Score score[2];
 
     u32 pawn_count[2];
     u32 light_pawn_count[2];
@@ -23,15 +32,85 @@ struct EvalData{
     u64 attack_units[2];
 };
 
+#define EVAL_CACHE_DEFAULT_KB 0   // Per thread
+#define EVAL_CACHE_MAX_KB     65536
+
+typedef struct {
+    u64 probes;
+    u64 hits;
+} CacheStats;
+
+typedef struct {
+    u64 calls;
+    u64 lazy;   // Calls that stopped after the cheap stage
+} LazyEvalStats;
+
 // Evaluation functions for a single position
-i32 eval_position(Position* pos);
+i32 eval_position(Position* pos, i32 alpha, i32 beta, u8* lazy);
+
+// Lazy eval counters of the calling thread
+LazyEvalStats lazy_eval_stats(void);
+void lazy_eval_reset_stats(void);
+
+// Pawn hash table counters of the calling thread
+CacheStats pawn_hash_stats(void);
+void pawn_hash_reset_stats(void);
+
+// Eval cache, one per search thread
+void set_eval_cache_size(u64 size_kb);
+void bind_eval_cache(u32 thread_num);
+void prefetch_eval(const Position* pos);
+void free_eval_caches(void);
+CacheStats eval_cache_stats(void);
+void eval_cache_reset_stats(void);
 
 // Quickly evaluate a position based on the material
 i32 eval_material(Position* pos);
 
+// Material, PST and phase sums of a position built from scratch
+EvalAccum init_eval_accum(const Position* pos);
+
+#ifdef RUNTIME_TABLES
 void init_pst();
+void init_lazy_margins();
+#endif
 
 // Global data
-extern i32 PST[2][12][64];
+extern TABLE_CONST Score PST[12][64];
+extern TABLE_CONST Score LazyGain[6]; // Most one piece of each type can add to its side through the terms lazy eval skips
+extern TABLE_CONST Score LazyLoss[6]; // and the most it can take away
+extern const i32 PieceValue[12];
+extern const i32 PiecePhase[12];
+
+/*
+ * Accumulator updates for a single piece, made next to the matching bitboard change
+ */
+static inline void accum_add_piece(EvalAccum* accum, u8 piece, i32 square){
+    Turn turn = PIECE_COLOR(piece);
+    accum->psqt[turn] += PST[piece][square];
+    accum->material[turn] += PieceValue[piece];
+    accum->phase_value += PiecePhase[piece];
+    accum->piece_count++;
+}
+
+static inline void accum_remove_piece(EvalAccum* accum, u8 piece, i32 square){
+    Turn turn = PIECE_COLOR(piece);
+    accum->psqt[turn] -= PST[piece][square];
+    accum->material[turn] -= PieceValue[piece];
+    accum->phase_value -= PiecePhase[piece];
+    accum->piece_count--;
+}
+
+static inline void accum_move_piece(EvalAccum* accum, u8 piece, i32 from, i32 to){
+    Turn turn = PIECE_COLOR(piece);
+    accum->psqt[turn] += PST[piece][to] - PST[piece][from];
+}
+
+/*
+ * One phase of a PST entry, for move ordering which scores with a single phase
+ */
+static inline i32 pst_value(u32 phase, u8 piece, i32 square){
+    return phase == PHASE_EG ? eg_value(PST[piece][square]) : mg_value(PST[piece][square]);
+}
 
 
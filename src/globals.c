@@ -4,6 +4,7 @@
 #include "types.h"
 #include "string.h"
 #include "util.h"
+#include "hash.h"
 #include <pthread.h>
 
 // Flags
@@ -11,18 +12,70 @@ _Atomic volatile i32 run_program;
 _Atomic volatile i32 run_get_best_move;
 _Atomic volatile i32 best_move_found;
 
-// Signals
-_Atomic volatile i32 print_pv_info;
-_Atomic volatile i32 print_best_move;
+// Signals, pending PRINT_* bits guarded by mutex_print
+static u32 print_signals;
 
 // Position Data
 static Position global_position;
 
-// PV Search Data
-static SearchData global_sd;
+// PV Search Data, published with a seqlock so readers never block the search
+// sequence is odd while a writer is copying, readers retry until they see the same even value before and after
+typedef struct {
+    _Atomic u32  sequence;
+    _Atomic u32  depth;
+    _Atomic i32  eval;
+    _Atomic Move best_move;
+    _Atomic u64  node_count;
+    _Atomic u64  elap_us;
+    _Atomic Move pv_array[MAX_DEPTH];
+} PublishedPV;
+
+static PublishedPV global_pv;
 
 static pthread_mutex_t mutex_global_position = PTHREAD_MUTEX_INITIALIZER;
-static pthread_mutex_t mutex_global_PV = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutex_print = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cond_print  = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Queues lines for the output thread and wakes it
+ */
+void post_print(u32 signals){
+    pthread_mutex_lock(&mutex_print);
+    print_signals |= signals;
+    pthread_cond_signal(&cond_print);
+    pthread_mutex_unlock(&mutex_print);
+}
+
+/*
+ * Drops queued lines that have not been printed yet
+ */
+void clear_print(u32 signals){
+    pthread_mutex_lock(&mutex_print);
+    print_signals &= ~signals;
+    pthread_mutex_unlock(&mutex_print);
+}
+
+/*
+ * Blocks the output thread until something is queued, returns and clears the pending signals
+ * Returns 0 once the program is closing
+ */
+u32 wait_print(void){
+    pthread_mutex_lock(&mutex_print);
+    while(!print_signals && run_program) pthread_cond_wait(&cond_print, &mutex_print);
+    u32 signals = print_signals;
+    print_signals = 0;
+    pthread_mutex_unlock(&mutex_print);
+    return signals;
+}
+
+/*
+ * Wakes the output thread so it sees run_program was cleared
+ */
+void wake_output(void){
+    pthread_mutex_lock(&mutex_print);
+    pthread_cond_broadcast(&cond_print);
+    pthread_mutex_unlock(&mutex_print);
+}
 
 /*
  * Sets up Initial Global Data Values
@@ -31,17 +84,11 @@ void init_globals(){
     run_program = TRUE;
     run_get_best_move = FALSE;
     best_move_found = FALSE;
-    print_pv_info = FALSE;
-    print_best_move = FALSE;
+    print_signals = 0;
 
     pthread_mutex_lock(&mutex_global_position);
     global_position = fen_to_position(START_FEN);
-    pthread_mutex_lock(&mutex_global_PV);
-    global_sd.pv_array = calloc(MAX_DEPTH, sizeof(Move));
-    global_sd.depth = 0;
-    global_sd.best_move = NO_MOVE;
-    global_sd.eval = 0;
-    pthread_mutex_unlock(&mutex_global_PV);
+    reset_global_pv_data();
     pthread_mutex_unlock(&mutex_global_position);
 }
 
@@ -53,26 +100,36 @@ void free_globals(){
 
     remove_hash_stack(&global_position.hashStack);
 
-    pthread_mutex_lock(&mutex_global_PV);
-    free(global_sd.pv_array);
-    global_sd.pv_array = NULL;
-
-    pthread_mutex_unlock(&mutex_global_PV);
     pthread_mutex_unlock(&mutex_global_position);
 }
 
 /*
- * Resets the global PV Data on a position change
+ * Takes the write side of the seqlock, writers are rare (once per iteration) so they just spin on each other
  */
-static void reset_global_pv_data(){
-    best_move_found = FALSE;
-    print_pv_info = FALSE;
-    pthread_mutex_lock(&mutex_global_PV);
-    global_sd.depth = 0;
-    global_sd.best_move = NO_MOVE;
-    global_sd.eval = 0;
-    pthread_mutex_unlock(&mutex_global_PV);
+static u32 pv_write_begin(){
+    u32 seq = atomic_load_explicit(&global_pv.sequence, memory_order_relaxed);
+    while((seq & 1) || !atomic_compare_exchange_weak_explicit(&global_pv.sequence, &seq, seq + 1, memory_order_acquire, memory_order_relaxed)){
+        seq = atomic_load_explicit(&global_pv.sequence, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+    return seq;
+}
+
+static void pv_write_end(u32 seq){
+    atomic_store_explicit(&global_pv.sequence, seq + 2, memory_order_release);
+}
 
+/*
+ * Resets the global PV Data on a position change or a new search
+ */
+void reset_global_pv_data(){
+    best_move_found = FALSE;
+    clear_print(PRINT_PV_INFO);
+    u32 seq = pv_write_begin();
+    atomic_store_explicit(&global_pv.depth, 0, memory_order_relaxed);
+    atomic_store_explicit(&global_pv.best_move, NO_MOVE, memory_order_relaxed);
+    atomic_store_explicit(&global_pv.eval, 0, memory_order_relaxed);
+    pv_write_end(seq);
 }
 
 /*
@@ -82,23 +139,27 @@ static void reset_global_pv_data(){
 u8 update_global_pv(u32 depth, Move* pv_array, i32 eval, SearchStats stats){
     if(pv_array == NULL || pv_array[0] == NO_MOVE) return FALSE;
 
-    pthread_mutex_lock(&mutex_global_PV); // Start Crit Section
+    u32 seq = pv_write_begin(); // Start Crit Section
 
-    if(depth <= global_sd.depth){ // If new depth is less or same as current exit
-        pthread_mutex_unlock(&mutex_global_PV);
+    if(depth <= atomic_load_explicit(&global_pv.depth, memory_order_relaxed)){ // If new depth is less or same as current exit
+        atomic_store_explicit(&global_pv.sequence, seq, memory_order_release); // Nothing was written, readers need not retry
         return FALSE;
     }
 
-    global_sd.depth = depth;
-    global_sd.eval = eval;
-    global_sd.stats = stats;
-    global_sd.best_move = pv_array[0];
-    memcpy(global_sd.pv_array, pv_array, (MAX_DEPTH)*sizeof(Move));
+    u32 pv_length = MIN(depth, MAX_DEPTH);
+    atomic_store_explicit(&global_pv.depth, depth, memory_order_relaxed);
+    atomic_store_explicit(&global_pv.eval, eval, memory_order_relaxed);
+    atomic_store_explicit(&global_pv.best_move, pv_array[0], memory_order_relaxed);
+    atomic_store_explicit(&global_pv.node_count, stats.node_count, memory_order_relaxed);
+    atomic_store_explicit(&global_pv.elap_us, (u64)(stats.elap_time * 1e6), memory_order_relaxed);
+    for(u32 i = 0; i < pv_length; i++){ // Only the moves that will be printed
+        atomic_store_explicit(&global_pv.pv_array[i], pv_array[i], memory_order_relaxed);
+    }
 
-    pthread_mutex_unlock(&mutex_global_PV);
+    pv_write_end(seq);
 
     best_move_found = TRUE; // Set flag that best move has been found
-    print_pv_info = TRUE;   // Set flag to print new PV
+    post_print(PRINT_PV_INFO);  // Signal to print new PV
     return TRUE;
 }
 
@@ -138,34 +199,36 @@ Position copy_global_position(){
 }
 
 /*
- * Returns the Global Best Move
+ * Returns the Global Best Move, a single word so it needs no retry loop
  */
 Move get_global_best_move() {
-    Move move;
-    pthread_mutex_lock(&mutex_global_PV);
-    move = global_sd.best_move;
-    pthread_mutex_unlock(&mutex_global_PV);
-    return move;
+    return atomic_load_explicit(&global_pv.best_move, memory_order_acquire);
 }
 
 /*
- * Returns the Global PV Data (ALLOCATES MEMORY IN RETURNED PV ARRAY)
+ * Returns a consistent snapshot of the Global PV Data without blocking the search
+ * The PV is copied into pv_buffer which must hold MAX_DEPTH moves
  */
-SearchData get_global_pv_data(){
-    SearchData data;
-
-    pthread_mutex_lock(&mutex_global_PV); // Start Crit Section
-
-    data.depth = global_sd.depth;
-    data.eval = global_sd.eval;
-    data.stats = global_sd.stats;
-    data.best_move = global_sd.best_move;
-    data.pv_array = malloc(MAX_DEPTH*sizeof(Move));
-    memcpy(data.pv_array, global_sd.pv_array, (MAX_DEPTH)*sizeof(Move));
-
-    pthread_mutex_unlock(&mutex_global_PV);
+SearchData get_global_pv_data(Move* pv_buffer){
+    SearchData data = {0};
+    data.pv_array = pv_buffer;
+    u32 seq;
+
+    do {
+        seq = atomic_load_explicit(&global_pv.sequence, memory_order_acquire);
+        if(seq & 1) continue; // A writer is mid copy
+
+        data.depth      = atomic_load_explicit(&global_pv.depth, memory_order_relaxed);
+        data.eval       = atomic_load_explicit(&global_pv.eval, memory_order_relaxed);
+        data.best_move  = atomic_load_explicit(&global_pv.best_move, memory_order_relaxed);
+        data.stats.node_count = atomic_load_explicit(&global_pv.node_count, memory_order_relaxed);
+        data.stats.elap_time  = atomic_load_explicit(&global_pv.elap_us, memory_order_relaxed) / 1e6;
+        u32 pv_length = MIN(data.depth, MAX_DEPTH);
+        for(u32 i = 0; i < pv_length; i++){
+            pv_buffer[i] = atomic_load_explicit(&global_pv.pv_array[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+    } while((seq & 1) || seq != atomic_load_explicit(&global_pv.sequence, memory_order_relaxed));
 
     return data;
 }
-
-
@@ -9,13 +9,19 @@ extern _Atomic volatile i32 run_program;
 extern _Atomic volatile i32 run_get_best_move;
 extern _Atomic volatile i32 best_move_found;
 
-//Print Signals
-extern _Atomic volatile i32 print_pv_info;
-extern _Atomic volatile i32 print_best_move;
+//Print Signals, posted by the search and consumed by the output thread
+#define PRINT_PV_INFO   1
+#define PRINT_BEST_MOVE 2
+
+void post_print(u32 signals);
+u32  wait_print(void);
+void clear_print(u32 signals);
+void wake_output(void);
 
 void init_globals();
 void free_globals();
 
+void reset_global_pv_data();
 u8 update_global_pv(u32 depth, Move* pv_array, i32 eval, SearchStats stats);
 
 void set_global_position(Position pos);
@@ -24,6 +30,6 @@ Position copy_global_position();
 
 Move get_global_best_move();
 
-SearchData get_global_pv_data();
+SearchData get_global_pv_data(Move* pv_buffer);
 
 #endif // GLOBALS_H
\ No newline at end of file
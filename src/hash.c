@@ -1,81 +1,99 @@
 #include "hash.h"
 #include "util.h"
-#include <time.h>
 #include <stdlib.h>
 
-static u64 zobristTable[64][12];
-static u64 zobristEnPassant[8];
-static u64 zobristCastle[4];
-static u64 zobristTurn;
+#ifdef RUNTIME_TABLES
+#define ZOBRIST_SEED 0x9E3779B97F4A7C15ULL
 
-static i32 convertPieceToIndex(char piece);
+u64 zobristTable[64][12];
+u64 zobristEnPassant[8];
+u64 zobristCastle[4];
+u64 zobristTurn;
+
+/*
+ * xorshift64*, seeded with a constant so the keys (and node counts) are the same on every build
+ */
+static u64 zobristRandom(u64* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
 
 void initZobrist(void) {
-    #ifdef __RAND_SEED
-    srand(__RAND_SEED);
-    #else
-    time_t t;
-    srand((unsigned) time(&t));
-    #endif
-    
+    u64 state = ZOBRIST_SEED;
 
     for (i32 square = 0; square < 64; square++) {
         for (i32 piece = 0; piece < 12; piece++) {
-            zobristTable[square][piece] = random_uint64();
+            zobristTable[square][piece] = zobristRandom(&state);
         }
     }
 
     for(i32 i = 0; i < 8; i++){
-        zobristEnPassant[i] = random_uint64();
+        zobristEnPassant[i] = zobristRandom(&state);
     }
 
     for(i32 i = 0; i < 4; i++){
-        zobristCastle[i] = random_uint64();
+        zobristCastle[i] = zobristRandom(&state);
     }
 
-    zobristTurn = random_uint64();
+    zobristTurn = zobristRandom(&state);
 }
+#endif
 
 u64 hashPosition(Position pos){
     u64 hash = 0;
 
     //Hash the board
     for (i32 i = 0; i < 64; i++) { 
-        if (pos.charBoard[i] != 0) { 
-            i32 piece = convertPieceToIndex(pos.charBoard[i]);
-            hash ^= zobristTable[i][piece];
+        if (pos.board[i] != NO_PIECE) { 
+            hash ^= zobristTable[i][pos.board[i]];
         }
     }
 
     //Hash the enpassant file
-    if(pos.en_passant) hash ^= zobristEnPassant[getlsb(pos.en_passant) % 8];
+    hash ^= hashEnPassantKey(pos.en_passant);
     
     //Hash the turn
     if(pos.flags & WHITE_TURN) hash ^= zobristTurn;
 
     //Hash the castle flags
-    if(pos.flags & W_SHORT_CASTLE) hash ^= zobristCastle[0];
-    if(pos.flags & W_LONG_CASTLE)  hash ^= zobristCastle[1];
-    if(pos.flags & B_SHORT_CASTLE) hash ^= zobristCastle[2];
-    if(pos.flags & B_LONG_CASTLE)  hash ^= zobristCastle[3];
+    hash ^= hashCastleKey(pos.flags);
 
     return hash;
 }
 
-static i32 convertPieceToIndex(char piece) {
-    switch (piece) {
-        case 'P': return 0;  // White Pawn
-        case 'N': return 1;  // White Knight
-        case 'B': return 2;  // White Bishop
-        case 'R': return 3;  // White Rook
-        case 'Q': return 4;  // White Queen
-        case 'K': return 5;  // White King
-        case 'p': return 6;  // Black Pawn
-        case 'n': return 7;  // Black Knight
-        case 'b': return 8;  // Black Bishop
-        case 'r': return 9;  // Black Rook
-        case 'q': return 10; // Black Queen
-        case 'k': return 11; // Black King
-        default:  return -1; // Invalid piece
+/*
+ * Zobrist hash of the pawns of both sides and nothing else
+ */
+u64 hashPawns(const Position* pos){
+    u64 hash = 0;
+    for(i32 color = BLACK; color <= WHITE; color++){
+        u64 pawns = pos->pieces[color][PAWN];
+        while(pawns){
+            hash ^= zobristTable[getlsb(pawns)][MAKE_PIECE(color, PAWN)];
+            pawns &= pawns - 1;
+        }
     }
+    return hash;
 }
+
+/*
+ * Allocates a new hash stack for a position
+ */
+HashStack createHashStack(void){
+    HashStack hs;
+    hs.ptr = calloc(HASHSTACK_SIZE, sizeof(u64));
+    hs.current_idx = 0;
+    hs.last_reset_idx = 0;
+    return hs;
+}
+
+/*
+ * Frees the memory held by a hash stack
+ */
+void remove_hash_stack(HashStack* hs){
+    free(hs->ptr);
+    hs->ptr = NULL;
+}
+
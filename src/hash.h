@@ -1,7 +1,43 @@
 #ifndef HASH_H
 #define HASH_H
 #include "types.h"
+#include "util.h"
+
+extern TABLE_CONST u64 zobristTable[64][12];
+extern TABLE_CONST u64 zobristEnPassant[8];
+extern TABLE_CONST u64 zobristCastle[4];
+extern TABLE_CONST u64 zobristTurn;
+
 u64 hashPosition(Position pos);
+u64 hashPawns(const Position* pos);
+#ifdef RUNTIME_TABLES
 void initZobrist(void);
+#endif
+HashStack createHashStack(void);
+void remove_hash_stack(HashStack* hs);
+
+/*
+ * Incremental hash keys, XOR these into a hash to add or remove the feature
+ */
+static inline u64 hashPieceKey(i32 square, i32 piece){
+    return zobristTable[square][piece];
+}
+
+static inline u64 hashEnPassantKey(u64 en_passant){
+    return en_passant ? zobristEnPassant[getlsb(en_passant) % 8] : 0ULL;
+}
+
+static inline u64 hashCastleKey(u8 flags){
+    u64 key = 0ULL;
+    if(flags & W_SHORT_CASTLE) key ^= zobristCastle[0];
+    if(flags & W_LONG_CASTLE)  key ^= zobristCastle[1];
+    if(flags & B_SHORT_CASTLE) key ^= zobristCastle[2];
+    if(flags & B_LONG_CASTLE)  key ^= zobristCastle[3];
+    return key;
+}
+
+static inline u64 hashTurnKey(void){
+    return zobristTurn;
+}
 
 #endif
\ No newline at end of file
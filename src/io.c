@@ -11,10 +11,19 @@
 #include "globals.h"
 #include "movement.h"
 #include "search.h"
-
-#ifdef DEBUG
+#include "perft.h"
+#include "threads.h"
+#include "transposition.h"
+#include "hash.h"
 #include "evaluator.h"
-#endif
+#include <unistd.h>
+
+#define OUTPUT_BUFFER_SIZE 4096 // Room for a full info line and the bestmove after it
+#define HASH_FILE_SIZE     1024
+
+static char hash_file[HASH_FILE_SIZE] = {0}; // Set with the Hash File option, used by savehash and loadhash
+static char hash_shared[HASH_FILE_SIZE] = {0}; // Shared memory segment named by the Hash Shared option, empty for a private table
+static u64 hash_size_mb = TT_DEFAULT_MB;
 
 static char isNullMove(char* moveStr){
     if(moveStr == NULL || strlen(moveStr) < 4) return 0;
@@ -37,6 +46,12 @@ static char* trimWhitespace(char* str) {
 static void processUCI(void) {
     printf("id name CraigEngine\r\n");
     printf("id author John\r\n");
+    printf("option name Threads type spin default 1 min 1 max %d\r\n", MAX_THREADS);
+    printf("option name Hash type spin default %d min 1 max %d\r\n", TT_DEFAULT_MB, TT_MAX_MB);
+    printf("option name Clear Hash type button\r\n");
+    printf("option name Hash File type string default <empty>\r\n");
+    printf("option name Hash Shared type string default <empty>\r\n");
+    printf("option name Eval Cache type spin default %d min 0 max %d\r\n", EVAL_CACHE_DEFAULT_KB, EVAL_CACHE_MAX_KB);
     printf("uciok\r\n");
 }
 
@@ -57,7 +72,8 @@ static void processMoves(char* str) {
         }
         //printf("Move String found: %s", moveStr);
         Position cur = get_global_position();
-        makeMove(&cur, moveStrToType(&cur, moveStr));
+        Undo undo;
+        makeMove(&cur, moveStrToType(&cur, moveStr), &undo);
         set_global_position(cur);
 get_next_token:
         pch = strtok_r(NULL, " ", &rest);
@@ -75,7 +91,7 @@ void processGoCommand(char* input) {
     u32 movestogo = 0;
     u8 infinite = FALSE;
 
-    SearchParameters params;
+    SearchParameters params = {0};
     params.depth = MAX_DEPTH - 1;
 
     token = strtok_r(input, " ", &saveptr);
@@ -117,7 +133,12 @@ void processGoCommand(char* input) {
         }else if (strcmp(token, "depth") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
-                params.depth = atol(token);
+                params.depth = MIN(MAX(atol(token), 1), MAX_DEPTH - 1);
+            }
+        } else if (strcmp(token, "nodes") == 0) {
+            token = strtok_r(NULL, " ", &saveptr);
+            if (token != NULL) {
+                params.max_nodes = strtoull(token, NULL, 10);
             }
         }
         token = strtok_r(NULL, " ", &saveptr);
@@ -127,7 +148,7 @@ void processGoCommand(char* input) {
         params.max_time = movetime;
         params.rec_time = movetime;
         params.can_shorten = FALSE;
-    } else if(infinite == TRUE){
+    } else if(infinite == TRUE || (wtime == 0 && btime == 0)){ // No clock to manage, run until depth, nodes or stop
         params.rec_time = 0;
         params.max_time = 0;
         params.can_shorten = FALSE;
@@ -140,10 +161,124 @@ void processGoCommand(char* input) {
     start_search(params);
 }
 
+/*
+ * perft <depth> [threads <n>] [hash <mb>], divide takes the same arguments
+ */
+static void processPerftCommand(char* input, u8 divide) {
+    char* token;
+    char* saveptr;
+    i32 depth = 1;
+    u32 hash_mb = 0;
+    u32 num_threads = online_cpus();
+
+    token = strtok_r(input, " \n", &saveptr);
+    if (token != NULL) depth = atoi(token);
+    while ((token = strtok_r(NULL, " \n", &saveptr)) != NULL) {
+        if (strcmp(token, "threads") == 0) {
+            token = strtok_r(NULL, " \n", &saveptr);
+            if (token != NULL) num_threads = atoi(token);
+        } else if (strcmp(token, "hash") == 0) {
+            token = strtok_r(NULL, " \n", &saveptr);
+            if (token != NULL) hash_mb = atoi(token);
+        }
+    }
+
+    Position pos = copy_global_position();
+    run_perft(&pos, depth, num_threads, hash_mb, divide);
+    remove_hash_stack(&pos.hashStack);
+}
+
+/*
+ * (Re)creates the table at hash_size_mb, in the shared segment when one is named, otherwise private
+ * An existing shared segment keeps its size, init_tt_shared warns when hash_size_mb is ignored
+ */
+static void resizeHash(void) {
+    stopSearch();
+    waitSearchThreads(); // The workers must be parked before their table is freed
+    if (hash_shared[0] != '\0' && init_tt_shared(hash_shared, hash_size_mb) == 0) return;
+    init_tt(hash_size_mb, online_cpus());
+}
+
+/*
+ * Empties the transposition table between games, a shared table is left alone since other processes may be searching it
+ */
+static void clearHash(void) {
+    if (tt_is_shared()) {
+        printf("info string Shared hash is not cleared, unlink it or set Hash Shared to empty first\n");
+        return;
+    }
+    stopSearch();
+    waitSearchThreads();
+    tt_clear(online_cpus());
+}
+
+/*
+ * savehash and loadhash, the table goes to or comes from the file set with the Hash File option
+ */
+static void processHashFile(u8 save) {
+    if (hash_file[0] == '\0') {
+        printf("info string Set the Hash File option first\n");
+        return;
+    }
+    stopSearch();
+    waitSearchThreads();
+    if (save) tt_save(hash_file);
+    else if (tt_load(hash_file) == 0) hash_size_mb = MAX(1, (tt_num_buckets * sizeof(TTBucket)) >> 20); // The table takes the size stored in the file
+}
+
+/*
+ * setoption name <id> [value <x>]
+ */
+static void processSetOption(char* input) {
+    char* name = strstr(input, "name ");
+    if (name == NULL) return;
+    name += 5;
+    char* value = strstr(name, " value ");
+
+    if (strncmp(name, "Threads", 7) == 0) {
+        if (value == NULL) return;
+        stopSearch();
+        set_num_threads(MAX(atoi(value + 7), 1));
+    }
+    else if (strncmp(name, "Hash File", 9) == 0) {
+        if (value == NULL) return;
+        char* path = trimWhitespace(value + 7);
+        if (strcmp(path, "<empty>") == 0) path = "";
+        snprintf(hash_file, sizeof(hash_file), "%s", path);
+    }
+    else if (strncmp(name, "Hash Shared", 11) == 0) {
+        if (value == NULL) return;
+        char* shm_name = trimWhitespace(value + 7);
+        if (strcmp(shm_name, "<empty>") == 0) shm_name = "";
+        snprintf(hash_shared, sizeof(hash_shared), "%s", shm_name);
+        resizeHash();
+    }
+    else if (strncmp(name, "Hash", 4) == 0) {
+        if (value == NULL) return;
+        hash_size_mb = strtoull(value + 7, NULL, 10);
+        resizeHash();
+    }
+    else if (strncmp(name, "Clear Hash", 10) == 0) {
+        clearHash();
+    }
+    else if (strncmp(name, "Eval Cache", 10) == 0) {
+        if (value == NULL) return;
+        stopSearch();
+        waitSearchThreads(); // Each worker's cache is freed and comes back at the new size when it next binds
+        set_eval_cache_size(strtoull(value + 7, NULL, 10));
+    }
+    else {
+        printf("info string Unknown option %s", name);
+    }
+}
+
 static i32 processInput(char* input){
     if (strncmp(input, "uci", 3) == 0) {
         input += 3;
-        if(strncmp(input, "newgame", 7) == 0) return 0;
+        if(strncmp(input, "newgame", 7) == 0){
+            if(!tt_is_shared()) clearHash(); // Skipped without the info string clearHash prints for a shared table
+            return 0;
+        }
         processUCI();
         fflush(stdout);
         return 0;
@@ -173,21 +308,42 @@ static i32 processInput(char* input){
         }
         fflush(stdout);
     }
+    else if (strncmp(input, "setoption", 9) == 0) {
+        processSetOption(input + 9);
+        fflush(stdout);
+    }
     else if (strncmp(input, "go", 2) == 0) {
         processGoCommand(input + 3);
     }
+    else if (strncmp(input, "savehash", 8) == 0) {
+        processHashFile(TRUE);
+        fflush(stdout);
+    }
+    else if (strncmp(input, "loadhash", 8) == 0) {
+        processHashFile(FALSE);
+        fflush(stdout);
+    }
+    else if (strncmp(input, "perft", 5) == 0) {
+        stopSearch();
+        processPerftCommand(input + 5, FALSE);
+    }
+    else if (strncmp(input, "divide", 6) == 0) {
+        stopSearch();
+        processPerftCommand(input + 6, TRUE);
+    }
     else if (strncmp(input, "stop", 4) == 0){
         #ifdef DEBUG
         printf("info string Stopping\n");
         #endif
         stopSearch();
-        print_best_move = TRUE;
+        post_print(PRINT_BEST_MOVE);
     }
     else if (strncmp(input, "quit", 4) == 0){
         printf("info string Closing Engine\n");
         fflush(stdout);
         stopSearch();
         run_program = FALSE;
+        wake_output();
         return 0;
     }
     #ifdef DEBUG
@@ -213,14 +369,16 @@ static i32 processInput(char* input){
         }
         else if (strncmp(input, "eval", 4) == 0){
             Position tempPos = get_global_position();
-            printf("Eval: %d\n", eval_position(&tempPos));
+            u8 lazy;
+            printf("Eval: %d\n", eval_position(&tempPos, MIN_EVAL, MAX_EVAL, &lazy));
         }
         else if (strncmp(input, "play move", 4) == 0){
             printf("Making move: ");
             printMove(get_global_best_move());
             printf("\n");
             Position tempPos = get_global_position();
-            makeMove(&tempPos, get_global_best_move());
+            Undo undo;
+            makeMove(&tempPos, get_global_best_move(), &undo);
             set_global_position(tempPos);
         }
 
@@ -241,22 +399,33 @@ i32 inputLoop(){
             break;
         }
     }
+    run_program = FALSE; // Closing stdin is the same as quit, let the output thread finish too
+    wake_output();
     return 0;
 }
 
+/*
+ * Sleeps until the search posts something to print, then writes every pending line with one write
+ */
 i32 outputLoop(){
+    static char out_buffer[OUTPUT_BUFFER_SIZE];
+    static Move pv_buffer[MAX_DEPTH];
+
     while(run_program){
-        if(print_pv_info){
-            SearchData data = get_global_pv_data();
-            printPVInfo(data);
-            print_pv_info = FALSE;
-            free(data.pv_array);
+        u32 signals = wait_print();
+        size_t len = 0;
+        if(signals & PRINT_PV_INFO){
+            SearchData data = get_global_pv_data(pv_buffer);
+            len += formatPVInfo(out_buffer + len, sizeof(out_buffer) - len, &data);
         }
-        if(print_best_move){
+        if(signals & PRINT_BEST_MOVE){
             Move move = get_global_best_move();
-            if(move != NO_MOVE) printBestMove(move);
-            print_best_move = FALSE;
+            if(move != NO_MOVE) len += formatBestMove(out_buffer + len, sizeof(out_buffer) - len, move);
+        }
+        if(len){
+            fwrite(out_buffer, 1, len, stdout);
+            fflush(stdout);
         }
     }
     return 0;
-}
\ No newline at end of file
+}
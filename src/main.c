@@ -14,6 +14,7 @@
 #include "tree.h"
 #include "util.h"
 #include "masks.h"
+#include "movement.h"
 
 #ifdef DEBUG
 #define RUN_TEST
@@ -24,13 +25,32 @@ void playSelfInfinite(void);
 
 
 #ifdef __PROFILE
+#define PROFILE_GAMES     8   // Games played before exiting, gprof only writes its output on exit
+#define PROFILE_MAX_MOVES 150 // Adjudicate long games so every run profiles the same amount of work
+
+/*
+ * Plays the engine against itself from the start position, searching each move to MAX_DEPTH
+ */
 void playSelfInfinite(void){
-    Position tempPos = get_global_position();
-    
-    while(generateLegalMoves(tempPos, moveList)){
-        makeMove(&tempPos, get_global_best_move());
-        set_global_position(tempPos);
+    Move moveList[MAX_MOVES];
+    Move pv_array[MAX_DEPTH] = {0};
+    KillerMoves km = {0};
+    SearchStats stats = {0};
+    Undo undo;
+
+    run_get_best_move = TRUE;
+    for(i32 game = 0; game < PROFILE_GAMES; game++){
+        Position pos = fen_to_position(START_FEN);
+        i32 eval = 0;
+        while(generateLegalMoves(&pos, moveList) && pos.halfmove_clock < 100 && pos.fullmove_number < PROFILE_MAX_MOVES){
+            for(u32 depth = 1; depth < MAX_DEPTH; depth++){
+                eval = search_tree(pos, depth, pv_array, &km, eval, &stats, NULL);
+            }
+            makeMove(&pos, pv_array[0], &undo);
+        }
+        remove_hash_stack(&pos.hashStack);
     }
+    run_get_best_move = FALSE;
 }
 #endif
 
@@ -38,15 +58,18 @@ void playSelfInfinite(void){
 * Behold the main function
 */
 i32 main(void) {
+    #ifdef RUNTIME_TABLES
     generateMasks();
-    generateMagics();
+    if(generateMagics()) return -1;
     initZobrist();
     init_pst();
-    if(init_tt(2)){
+    init_lazy_margins();
+    init_masks();
+    #endif
+    if(init_tt(TT_DEFAULT_MB, online_cpus())){
         printf("info string Warning failed to create transposition table, exiting.\n");
         return -1;
     }
-    init_masks();
     init_globals();
 
     printf("info string Finished start up!\n");
@@ -56,15 +79,16 @@ i32 main(void) {
     #endif
 
     #ifdef __PROFILE
-    printf("info string In profile mode, playing forever.\r\n");
+    printf("info string In profile mode, playing %d games against itself.\r\n", PROFILE_GAMES);
     fflush(stdout);
     playSelfInfinite();
-    #endif  
-
+    #else
     launch_threads();
     stopSearch();
     printf("info string All threads have finished.\n");
+    #endif
     free_globals();
+    free_eval_caches();
     tt_free();
     printf("info string All memory freed\n");
     printf("info string Goodbye! :)\n");
@@ -4,6 +4,7 @@
 #include "types.h"
 #include "util.h"
 
+#ifdef RUNTIME_TABLES
 u64 PassedPawnMask[2][64] = {0};
 
 u64 KnightOutpostMask[2] = {0};
@@ -56,6 +57,4 @@ void init_masks(){
     BishopOutpostMask[WHITE_TURN] = 0x00007E7E7E000000;
     BishopOutpostMask[BLACK_TURN] = 0x0000007E7E7E0000;
 }
-
-
-
+#endif
@@ -2,13 +2,15 @@
 
 #include "types.h"
 
-extern u64 PassedPawnMask[2][64];
+extern TABLE_CONST u64 PassedPawnMask[2][64];
 
-extern u64 KnightOutpostMask[2];
+extern TABLE_CONST u64 KnightOutpostMask[2];
 
-extern u64 KingAreaMask[64];
+extern TABLE_CONST u64 KingAreaMask[64];
 
-extern u64 BishopOutpostMask[2];
+extern TABLE_CONST u64 BishopOutpostMask[2];
 
+#ifdef RUNTIME_TABLES
 void init_masks();
+#endif
 
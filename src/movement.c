@@ -1,259 +1,229 @@
 #include "movement.h"
-#include <ctype.h>
 #include "./bitboard/magic.h"
 #include "./bitboard/bitboard.h"
 #include "./bitboard/bbutils.h"
 #include "evaluator.h"
 #include "util.h"
 #include "hash.h"
+#include <string.h>
 
 u16 generateLegalMoves(Position* position,  Move* moveList){
     i32 size[] = {0};
     i32 turn = position->flags & WHITE_TURN; //True for white false for black
     u64 ownPos = position->color[turn];
     u64 oppPos = position->color[!turn];
-    u64 oppAttackMask = position->attack_mask[!turn];
+    u64 oppAttackMask = getAttackMask(position, !turn);
 
     if(position->flags & IN_CHECK){
         if(position->flags & IN_D_CHECK){
-            getKingMovesAppend(position->king[turn], ownPos, oppPos, oppAttackMask, moveList, size);
+            getKingMovesAppend(position->pieces[turn][KING], ownPos, oppPos, oppAttackMask, moveList, size);
         }
         else{
             getCheckMovesAppend(position, moveList, size);
         }
     }
-    else if(position->pinned & ownPos){
+    else if(getPinnedPieces(position) & ownPos){
         getPinnedMovesAppend(position, moveList, size);
     }
     else{
         getCastleMovesAppend(ownPos | oppPos, oppAttackMask, position->flags, moveList, size);
 
-        getBishopMovesAppend(position->queen[turn],  ownPos, oppPos, moveList, size);
-        getRookMovesAppend(  position->queen[turn],  ownPos, oppPos, moveList, size);
-        getRookMovesAppend(  position->rook[turn],   ownPos, oppPos, moveList, size);
-        getBishopMovesAppend(position->bishop[turn], ownPos, oppPos, moveList, size);
-        getKnightMovesAppend(position->knight[turn], ownPos, oppPos, moveList, size);
-        getKingMovesAppend(  position->king[turn],   ownPos, oppPos, oppAttackMask, moveList, size);
-        getPawnMovesAppend(  position->pawn[turn],   ownPos, oppPos, position->en_passant, position->flags, moveList, size);
+        getBishopMovesAppend(position->pieces[turn][QUEEN],  ownPos, oppPos, moveList, size);
+        getRookMovesAppend(  position->pieces[turn][QUEEN],  ownPos, oppPos, moveList, size);
+        getRookMovesAppend(  position->pieces[turn][ROOK],   ownPos, oppPos, moveList, size);
+        getBishopMovesAppend(position->pieces[turn][BISHOP], ownPos, oppPos, moveList, size);
+        getKnightMovesAppend(position->pieces[turn][KNIGHT], ownPos, oppPos, moveList, size);
+        getKingMovesAppend(  position->pieces[turn][KING],   ownPos, oppPos, oppAttackMask, moveList, size);
+        getPawnMovesAppend(  position->pieces[turn][PAWN],   ownPos, oppPos, position->en_passant, position->flags, moveList, size);
     }
     return *size;
 }
 
-/* Generate Moves that capture pieces, and put the opponents king in check */
-u16 generateThreatMoves(Position* position,  Move* moveList){
+/*
+ * Appends the captures of the side to move, plus the quiet moves that land on the check squares given per piece
+ * In check every evasion is appended
+ */
+static u16 generateMovesTo(Position* position, Move* moveList, u64 r_check_squares, u64 b_check_squares, u64 n_check_squares, u64 p_check_squares){
     i32 size[] = {0};
     i32 turn = position->flags & TURN_MASK;
     u64 ownPos = position->color[turn];
     u64 oppPos = position->color[!turn];
-    u64 oppAttackMask = position->attack_mask[!turn];
-
-    i32 kingSq = getlsb(position->king[!turn]);
-    u64 r_check_squares = rookAttacks(  ownPos | oppPos, kingSq) & ~(ownPos | oppPos);
-    u64 b_check_squares = bishopAttacks(ownPos | oppPos, kingSq) & ~(ownPos | oppPos);
+    u64 oppAttackMask = getAttackMask(position, !turn);
 
     if(position->flags & IN_CHECK){
         if(position->flags & IN_D_CHECK){
-            getKingMovesAppend(position->king[turn], ownPos, oppPos, oppAttackMask, moveList, size);
+            getKingMovesAppend(position->pieces[turn][KING], ownPos, oppPos, oppAttackMask, moveList, size);
         }
         else{
             getCheckMovesAppend(position, moveList, size);
         }
     }
-    else if(position->pinned & ownPos){
-        getPinnedThreatMovesAppend(position, r_check_squares, b_check_squares, kingSq, moveList, size);
+    else if(getPinnedPieces(position) & ownPos){
+        getPinnedThreatMovesAppend(position, r_check_squares, b_check_squares, n_check_squares, p_check_squares, moveList, size);
     }
     else{
-        getBishopThreatMovesAppend(position->queen[turn],  ownPos, oppPos, b_check_squares, moveList, size);
-        getRookThreatMovesAppend(  position->queen[turn],  ownPos, oppPos, r_check_squares, moveList, size);
-        getRookThreatMovesAppend(  position->rook[turn],   ownPos, oppPos, r_check_squares, moveList, size);
-        getBishopThreatMovesAppend(position->bishop[turn], ownPos, oppPos, b_check_squares, moveList, size);
-        getKnightThreatMovesAppend(position->knight[turn], ownPos, oppPos, kingSq, moveList, size);
-        getKingThreatMovesAppend(  position->king[turn],   ownPos, oppPos, oppAttackMask, moveList, size);
-        getPawnThreatMovesAppend(  position->pawn[turn],   ownPos, oppPos, position->en_passant, position->flags, kingSq, moveList, size);
+        getBishopThreatMovesAppend(position->pieces[turn][QUEEN],  ownPos, oppPos, b_check_squares, moveList, size);
+        getRookThreatMovesAppend(  position->pieces[turn][QUEEN],  ownPos, oppPos, r_check_squares, moveList, size);
+        getRookThreatMovesAppend(  position->pieces[turn][ROOK],   ownPos, oppPos, r_check_squares, moveList, size);
+        getBishopThreatMovesAppend(position->pieces[turn][BISHOP], ownPos, oppPos, b_check_squares, moveList, size);
+        getKnightThreatMovesAppend(position->pieces[turn][KNIGHT], ownPos, oppPos, n_check_squares, moveList, size);
+        getKingThreatMovesAppend(  position->pieces[turn][KING],   ownPos, oppPos, oppAttackMask, moveList, size);
+        getPawnThreatMovesAppend(  position->pieces[turn][PAWN],   ownPos, oppPos, position->en_passant, position->flags, p_check_squares, moveList, size);
     }
     return *size;
 }
 
+/* Generate Moves that capture pieces, and put the opponents king in check */
+u16 generateThreatMoves(Position* position,  Move* moveList){
+    i32 turn = position->flags & TURN_MASK;
+    u64 occ = position->color[0] | position->color[1];
+    i32 kingSq = getlsb(position->pieces[!turn][KING]);
+    u64 r_check_squares = rookAttacks(  occ, kingSq) & ~occ;
+    u64 b_check_squares = bishopAttacks(occ, kingSq) & ~occ;
+    return generateMovesTo(position, moveList, r_check_squares, b_check_squares, knightAttacks(kingSq), pawnAttacks(kingSq, !turn));
+}
 
-static void movePiece(Position *pos, i32 turn, i32 from, i32 to){
-    switch(toupper(pos->charBoard[from])){
-        case 'Q':
-            pos->queen[turn] = clearBit(pos->queen[turn], from);
-            pos->queen[turn] = setBit(pos->queen[turn], to);
-            break;
-        case 'K':
-            pos->king[turn] = clearBit(pos->king[turn], from);
-            pos->king[turn] = setBit(pos->king[turn], to);
-            break;
-        case 'N':
-            pos->knight[turn] = clearBit(pos->knight[turn], from);
-            pos->knight[turn] = setBit(pos->knight[turn], to);
-            break;
-        case 'B':
-            pos->bishop[turn] = clearBit(pos->bishop[turn], from);
-            pos->bishop[turn] = setBit(pos->bishop[turn], to);
-            break;
-        case 'R':
-            pos->rook[turn] = clearBit(pos->rook[turn], from);
-            pos->rook[turn] = setBit(pos->rook[turn], to);
-            break;
-        case 'P':
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->pawn[turn] = setBit(pos->pawn[turn], to);
-            pos->halfmove_clock = 0;
-            break;
+/*
+ * Generate every legal capture and promotion, the promotion rank stands in for the pawn check squares
+ * Used by the move picker so a cut on a capture never pays for the quiet moves
+ */
+u16 generateCaptureMoves(Position* position,  Move* moveList){
+    u64 promotion_rank = (position->flags & TURN_MASK) ? 0xFF00000000000000ULL : 0xFFULL;
+    u16 size = generateMovesTo(position, moveList, 0ULL, 0ULL, 0ULL, promotion_rank);
+    if(position->flags & IN_CHECK){ // Evasions come out whole, keep only the captures and promotions
+        u16 captures = 0;
+        for(u16 i = 0; i < size; i++){
+            if(GET_FLAGS(moveList[i]) >= CAPTURE) moveList[captures++] = moveList[i];
+        }
+        size = captures;
     }
-    pos->charBoard[to] = pos->charBoard[from];
-    pos->charBoard[from] = 0;
+    return size;
+}
+
 
-    pos->color[turn] = clearBit(pos->color[turn], from);
-    pos->color[turn] = setBit(pos->color[turn], to);
+static inline void movePiece(Position *pos, i32 from, i32 to){
+    u8 piece = pos->board[from];
+    u64 from_to = (1ULL << from) | (1ULL << to);
+
+    pos->piece_bb[piece] ^= from_to;
+    pos->color[PIECE_COLOR(piece)] ^= from_to;
+
+    pos->board[to] = piece;
+    pos->board[from] = NO_PIECE;
+
+    pos->hash ^= hashPieceKey(from, piece) ^ hashPieceKey(to, piece);
+    accum_move_piece(&pos->accum, piece, from, to);
+    if(PIECE_TYPE(piece) == PAWN){
+        pos->pawn_hash ^= hashPieceKey(from, piece) ^ hashPieceKey(to, piece);
+        pos->halfmove_clock = 0;
+    }
 }
 
 /* Used to remove the captured piece */
-static void removeCaptured(Position *pos, i32 square){
-    i32 turn = pos->flags & WHITE_TURN;
-    switch(toupper(pos->charBoard[square])){
-        case 'Q':
-            pos->queen[!turn] = clearBit(pos->queen[!turn], square);
-            break;
-        case 'K':
-            //pos->king[!turn] = clearBit(pos->king[!turn], square);
-            #ifdef DEBUG
-            printf("WARNING ATTEMPTED TO CAPTURE A KING AT POS:\n");
-            printPosition(*pos, TRUE);
-            while(TRUE){};
-            #else
-            printf("info string Found illegal position during search - King Capture.\n");
-            #endif
-            break;
-        case 'N':
-            pos->knight[!turn] = clearBit(pos->knight[!turn], square);
-            break;
-        case 'B':
-            pos->bishop[!turn] = clearBit(pos->bishop[!turn], square);
-            break;
-        case 'R':
-            pos->rook[!turn] = clearBit(pos->rook[!turn], square);
-            break;
-        case 'P':
-            pos->pawn[!turn] = clearBit(pos->pawn[!turn], square);
-            break;
+static inline void removeCaptured(Position *pos, i32 square){
+    u8 piece = pos->board[square];
+    #ifdef DEBUG
+    if(PIECE_TYPE(piece) == KING){
+        printf("WARNING ATTEMPTED TO CAPTURE A KING AT POS:\n");
+        printPosition(*pos, TRUE);
+        while(TRUE){};
     }
-    pos->color[!turn] = clearBit(pos->color[!turn], square);
-    pos->charBoard[square] = 0;
+    #else
+    if(PIECE_TYPE(piece) == KING) printf("info string Found illegal position during search - King Capture.\n");
+    #endif
+
+    pos->piece_bb[piece] = clearBit(pos->piece_bb[piece], square);
+    pos->color[PIECE_COLOR(piece)] = clearBit(pos->color[PIECE_COLOR(piece)], square);
+    pos->board[square] = NO_PIECE;
+
+    pos->hash ^= hashPieceKey(square, piece);
+    accum_remove_piece(&pos->accum, piece, square);
+    if(PIECE_TYPE(piece) == PAWN) pos->pawn_hash ^= hashPieceKey(square, piece);
+    pos->halfmove_clock = 0;
+}
+
+/* Replaces the pawn on from with a piece of type on to, not inlined as promotions are rare */
+static void promotePawn(Position *pos, i32 from, i32 to, PieceType type){
+    u8 pawn = pos->board[from];
+    u8 promo = MAKE_PIECE(PIECE_COLOR(pawn), type);
+
+    pos->piece_bb[pawn]  = clearBit(pos->piece_bb[pawn], from);
+    pos->piece_bb[promo] = setBit(pos->piece_bb[promo], to);
+    pos->color[PIECE_COLOR(pawn)] ^= (1ULL << from) | (1ULL << to);
+
+    pos->board[from] = NO_PIECE;
+    pos->board[to] = promo;
+
+    pos->hash ^= hashPieceKey(from, pawn) ^ hashPieceKey(to, promo);
+    pos->pawn_hash ^= hashPieceKey(from, pawn);
+    accum_remove_piece(&pos->accum, pawn, from);
+    accum_add_piece(&pos->accum, promo, to);
     pos->halfmove_clock = 0;
 }
 
-i32 makeMove(Position *pos, Move move){
+i32 makeMove(Position *pos, Move move, Undo *undo){
     #ifdef DEBUG
     if(move == NO_MOVE) printf("WARNING ILLEGAL NO-MOVE IN MAKE MOVE\n");
     #endif
     i32 turn = pos->flags & WHITE_TURN;
     i32 from = GET_FROM(move);
     i32 to   = GET_TO(move);
+
+    undo->en_passant     = pos->en_passant;
+    undo->pinned         = pos->pinned;
+    undo->checkers       = pos->checkers;
+    undo->hash           = pos->hash;
+    undo->pawn_hash      = pos->pawn_hash;
+    undo->attack_mask[0] = pos->attack_mask[0];
+    undo->attack_mask[1] = pos->attack_mask[1];
+    undo->accum          = pos->accum;
+    undo->halfmove_clock = pos->halfmove_clock;
+    undo->last_reset_idx = pos->hashStack.last_reset_idx;
+    undo->stage          = pos->stage;
+    undo->flags          = pos->flags;
+    undo->lazy_valid     = pos->lazy_valid;
+    undo->captured       = pos->board[to];
     
+    // Remove the old en passant and castle state from the hash, they are added back after the move
+    pos->hash ^= hashEnPassantKey(pos->en_passant) ^ hashCastleKey(pos->flags);
+
     pos->halfmove_clock++;
     pos->en_passant = 0ULL;
 
     // Handle move flags
     switch(GET_FLAGS(move)){
         case QUEEN_PROMO_CAPTURE:
-            removeCaptured(pos, to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from); 
-            pos->charBoard[from] = 0;
-            pos->queen[turn] = setBit(pos->queen[turn], to); 
-            pos->charBoard[to] = turn ? 'Q' : 'q';
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->halfmove_clock = 0;
-            break;
         case ROOK_PROMO_CAPTURE:
-            removeCaptured(pos, to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from); 
-            pos->charBoard[from] = 0;
-            pos->rook[turn] = setBit(pos->rook[turn], to); 
-            pos->charBoard[to] = turn ? 'R' : 'r';
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->halfmove_clock = 0;
-            break;
         case BISHOP_PROMO_CAPTURE:
-            removeCaptured(pos, to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from); 
-            pos->charBoard[from] = 0;
-            pos->bishop[turn] = setBit(pos->bishop[turn], to); 
-            pos->charBoard[to] = turn ? 'B' : 'b';
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->halfmove_clock = 0;
-            break;
         case KNIGHT_PROMO_CAPTURE:
             removeCaptured(pos, to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from); 
-            pos->charBoard[from] = 0;
-            pos->knight[turn] = setBit(pos->knight[turn], to); 
-            pos->charBoard[to] = turn ? 'N' : 'n';
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->halfmove_clock = 0;
+            promotePawn(pos, from, to, PROMO_PIECE_TYPE(GET_FLAGS(move)));
+            break;
+        case QUEEN_PROMOTION:
+        case ROOK_PROMOTION:
+        case BISHOP_PROMOTION:
+        case KNIGHT_PROMOTION:
+            promotePawn(pos, from, to, PROMO_PIECE_TYPE(GET_FLAGS(move)));
             break;
             
         case EP_CAPTURE:
             removeCaptured(pos, (turn ? to - 8 : to + 8));
-            movePiece(pos, turn, from, to);
+            movePiece(pos, from, to);
             break;
         case CAPTURE:
             removeCaptured(pos, to);
-            movePiece(pos, turn, from, to);
+            movePiece(pos, from, to);
             break;
 
-        case QUEEN_PROMOTION:
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->queen[turn] = setBit(pos->queen[turn], to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->charBoard[from] = 0;
-            pos->charBoard[to] = turn ? 'Q' : 'q';
-            pos->halfmove_clock = 0;
-            break;
-        case ROOK_PROMOTION:
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->rook[turn] = setBit(pos->rook[turn], to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->charBoard[from] = 0;
-            pos->charBoard[to] = turn ? 'R' : 'r';
-            pos->halfmove_clock = 0;
-            break;
-        case BISHOP_PROMOTION:
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->bishop[turn] = setBit(pos->bishop[turn], to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->charBoard[from] = 0;
-            pos->charBoard[to] = turn ? 'B' : 'b';
-            pos->halfmove_clock = 0;
-            break;
-        case KNIGHT_PROMOTION:
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->knight[turn] = setBit(pos->knight[turn], to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->charBoard[from] = 0;
-            pos->charBoard[to] = turn ? 'N' : 'n';
-            pos->halfmove_clock = 0;
-            break;
-            
         case QUEEN_CASTLE:
             pos->flags &= ~(turn ? W_LONG_CASTLE : B_LONG_CASTLE);
-            movePiece(pos, turn, from, to);
-            movePiece(pos, turn, turn ? 0 : 56, turn ? 3 : 59);
+            movePiece(pos, from, to);
+            movePiece(pos, turn ? 0 : 56, turn ? 3 : 59);
             break;
         case KING_CASTLE:
             pos->flags &= ~(turn ? W_SHORT_CASTLE : B_SHORT_CASTLE);
-            movePiece(pos, turn, from, to);
-            movePiece(pos, turn, turn ? 7 : 63, turn ? 5 : 61);
+            movePiece(pos, from, to);
+            movePiece(pos, turn ? 7 : 63, turn ? 5 : 61);
             break;
 
         case DOUBLE_PAWN_PUSH:
@@ -261,7 +231,7 @@ i32 makeMove(Position *pos, Move move){
             // Fall through
         case QUIET:
         default:
-            movePiece(pos, turn, from, to);
+            movePiece(pos, from, to);
             break;
     }
 
@@ -277,39 +247,55 @@ i32 makeMove(Position *pos, Move move){
 
     if(!turn) pos->fullmove_number++;
 
-    setAttackMasks(pos);
-
-    //Check Flag
-    pos->flags = pos->attack_mask[turn] & pos->king[!turn] ? (pos->flags | IN_CHECK) : (pos->flags & ~IN_CHECK);
-
-    //Double Check Flag
-    if(pos->flags & IN_CHECK){
-       i32 king_sq = getlsb(pos->king[!turn]);
-       u64 attackers = getAttackers(pos, king_sq, turn);
-       attackers &= attackers - 1;
-       if(attackers) pos->flags |= IN_D_CHECK;
+    // Checkers are the only attack info made here, attack masks and pins are made on first use
+    pos->checkers = getAttackers(pos, getlsb(pos->pieces[!turn][KING]), turn);
+    pos->flags &= ~(IN_CHECK | IN_D_CHECK);
+    if(pos->checkers){
+        pos->flags |= IN_CHECK;
+        if(pos->checkers & (pos->checkers - 1)) pos->flags |= IN_D_CHECK;
     }
-    else pos->flags &= ~IN_D_CHECK;
 
     pos->flags ^= WHITE_TURN;
 
-    pos->pinned = generatePinnedPieces(pos);
-
-    pos->stage = calculateStage(*pos);
+    pos->hash ^= hashEnPassantKey(pos->en_passant) ^ hashCastleKey(pos->flags) ^ hashTurnKey();
 
-    pos->material_eval = eval_material(pos);
+    pos->lazy_valid = 0;
+    #ifdef EAGER_ATTACK_MASKS
+    setAttackMasks(pos);
+    getPinnedPieces(pos);
+    #endif
 
-    pos->hash = hashPosition(*pos);
+    pos->stage = calculateStage(pos);
 
     pos->hash_stack_idx++;
 
+    HashStack* hs = &pos->hashStack;
     hs->current_idx = (hs->current_idx + 1) % HASHSTACK_SIZE;
     if(pos->halfmove_clock == 0) hs->last_reset_idx = hs->current_idx;
     hs->ptr[hs->current_idx] = pos->hash;    
 
 
     #ifdef DEBUG
-    if(count_bits(pos->king[0]) != 1 || count_bits(pos->king[1]) != 1){
+    if(pos->hash != hashPosition(*pos)){
+        printf("WARNING INCREMENTAL HASH DOES NOT MATCH FULL HASH AFTER MOVE: ");
+        printMove(move);
+        printf("\n");
+        printPosition(*pos, TRUE);
+    }
+    if(pos->pawn_hash != hashPawns(pos)){
+        printf("WARNING INCREMENTAL PAWN HASH DOES NOT MATCH FULL PAWN HASH AFTER MOVE: ");
+        printMove(move);
+        printf("\n");
+        printPosition(*pos, TRUE);
+    }
+    EvalAccum full_accum = init_eval_accum(pos);
+    if(memcmp(&pos->accum, &full_accum, sizeof(EvalAccum))){
+        printf("WARNING INCREMENTAL EVAL ACCUMULATORS DO NOT MATCH FULL SUMS AFTER MOVE: ");
+        printMove(move);
+        printf("\n");
+        printPosition(*pos, TRUE);
+    }
+    if(count_bits(pos->pieces[0][KING]) != 1 || count_bits(pos->pieces[1][KING]) != 1){
         printf("Illegal Position found without correct number of kings.\n");
         printPosition(*pos, TRUE);
 
@@ -323,33 +309,160 @@ i32 makeMove(Position *pos, Move move){
     return 0;
 }
 
-i32 makeNullMove(Position *pos){
+i32 makeNullMove(Position *pos, Undo *undo){
+    undo->en_passant     = pos->en_passant;
+    undo->pinned         = pos->pinned;
+    undo->checkers       = pos->checkers;
+    undo->hash           = pos->hash;
+    undo->halfmove_clock = pos->halfmove_clock;
+    undo->flags          = pos->flags;
+    undo->lazy_valid     = pos->lazy_valid;
 
     pos->halfmove_clock++;
     if(!(pos->flags & TURN_MASK)) pos->fullmove_number++;
 
     pos->flags ^= TURN_MASK;
+    pos->hash ^= hashTurnKey();
+
+    // Null moves are never made in check, so the new side to move can't be in check either
+    pos->checkers = 0ULL;
 
     // If there was an en passant square we have to regen pinned pieces
     if(pos->en_passant){
+        pos->hash ^= hashEnPassantKey(pos->en_passant);
         pos->en_passant = 0ULL;
-        pos->pinned = generatePinnedPieces(pos);
+        pos->lazy_valid &= ~LAZY_PINNED;
+        #ifdef EAGER_ATTACK_MASKS
+        getPinnedPieces(pos);
+        #endif
     }
 
-    pos->hash = hashPosition(*pos);
+    #ifdef DEBUG
+    if(pos->hash != hashPosition(*pos)){
+        printf("WARNING INCREMENTAL HASH DOES NOT MATCH FULL HASH AFTER NULL MOVE\n");
+        printPosition(*pos, TRUE);
+    }
+    #endif
 
     return 0;
 }
 
-void unmakeMove(Position *position, Move move){
-    // Suppress errors until I implement this ;P
-    (void)*position;
-    (void)move;
+/* Moves a piece from "to" back to "from", the hash is restored from the undo so it is left alone */
+static inline void unmovePiece(Position *pos, i32 from, i32 to){
+    u8 piece = pos->board[to];
+    u64 from_to = (1ULL << from) | (1ULL << to);
+
+    pos->piece_bb[piece] ^= from_to;
+    pos->color[PIECE_COLOR(piece)] ^= from_to;
+
+    pos->board[from] = piece;
+    pos->board[to] = NO_PIECE;
+}
+
+/* Puts a captured piece back on the board */
+static inline void restoreCaptured(Position *pos, i32 square, u8 piece){
+    pos->piece_bb[piece] = setBit(pos->piece_bb[piece], square);
+    pos->color[PIECE_COLOR(piece)] = setBit(pos->color[PIECE_COLOR(piece)], square);
+    pos->board[square] = piece;
+}
+
+/* Turns a promoted piece back into the pawn that made the move */
+static inline void unpromotePawn(Position *pos, i32 from, i32 to){
+    u8 promo = pos->board[to];
+    u8 pawn = MAKE_PIECE(PIECE_COLOR(promo), PAWN);
+
+    pos->piece_bb[promo] = clearBit(pos->piece_bb[promo], to);
+    pos->piece_bb[pawn]  = setBit(pos->piece_bb[pawn], from);
+    pos->color[PIECE_COLOR(promo)] ^= (1ULL << from) | (1ULL << to);
+
+    pos->board[to] = NO_PIECE;
+    pos->board[from] = pawn;
+}
+
+/* Reverts makeMove(pos, move, undo), undo must be the one filled by that call */
+void unmakeMove(Position *pos, Move move, Undo *undo){
+    i32 turn = undo->flags & WHITE_TURN; // The side that made the move
+    i32 from = GET_FROM(move);
+    i32 to   = GET_TO(move);
+
+    switch(GET_FLAGS(move)){
+        case QUEEN_PROMO_CAPTURE:
+        case ROOK_PROMO_CAPTURE:
+        case BISHOP_PROMO_CAPTURE:
+        case KNIGHT_PROMO_CAPTURE:
+            unpromotePawn(pos, from, to);
+            restoreCaptured(pos, to, undo->captured);
+            break;
+        case QUEEN_PROMOTION:
+        case ROOK_PROMOTION:
+        case BISHOP_PROMOTION:
+        case KNIGHT_PROMOTION:
+            unpromotePawn(pos, from, to);
+            break;
+
+        case EP_CAPTURE:
+            unmovePiece(pos, from, to);
+            restoreCaptured(pos, (turn ? to - 8 : to + 8), MAKE_PIECE(!turn, PAWN));
+            break;
+        case CAPTURE:
+            unmovePiece(pos, from, to);
+            restoreCaptured(pos, to, undo->captured);
+            break;
+
+        case QUEEN_CASTLE:
+            unmovePiece(pos, from, to);
+            unmovePiece(pos, turn ? 0 : 56, turn ? 3 : 59);
+            break;
+        case KING_CASTLE:
+            unmovePiece(pos, from, to);
+            unmovePiece(pos, turn ? 7 : 63, turn ? 5 : 61);
+            break;
+
+        case DOUBLE_PAWN_PUSH:
+        case QUIET:
+        default:
+            unmovePiece(pos, from, to);
+            break;
+    }
+
+    if(!turn) pos->fullmove_number--;
+
+    pos->en_passant     = undo->en_passant;
+    pos->pinned         = undo->pinned;
+    pos->checkers       = undo->checkers;
+    pos->hash           = undo->hash;
+    pos->pawn_hash      = undo->pawn_hash;
+    pos->attack_mask[0] = undo->attack_mask[0];
+    pos->attack_mask[1] = undo->attack_mask[1];
+    pos->accum          = undo->accum;
+    pos->halfmove_clock = undo->halfmove_clock;
+    pos->stage          = undo->stage;
+    pos->flags          = undo->flags;
+    pos->lazy_valid     = undo->lazy_valid;
+
+    pos->hash_stack_idx--;
+
+    HashStack* hs = &pos->hashStack;
+    hs->current_idx = (hs->current_idx + HASHSTACK_SIZE - 1) % HASHSTACK_SIZE;
+    hs->last_reset_idx = undo->last_reset_idx;
+}
+
+/* Reverts makeNullMove(pos, undo) */
+void unmakeNullMove(Position *pos, Undo *undo){
+    if(!(undo->flags & TURN_MASK)) pos->fullmove_number--;
+
+    pos->en_passant     = undo->en_passant;
+    pos->pinned         = undo->pinned;
+    pos->checkers       = undo->checkers;
+    pos->hash           = undo->hash;
+    pos->halfmove_clock = undo->halfmove_clock;
+    pos->flags          = undo->flags;
+    pos->lazy_valid     = undo->lazy_valid;
 }
 
 static u64 generatePinnedPiecesColor(Position* pos, i32 turn){
     u64 pos_pinners;
-    i32 k_square = getlsb(pos->king[turn]);
+    i32 k_square = getlsb(pos->pieces[turn][KING]);
 
     //Contains all the initial pieces
     u64 all_pieces = pos->color[0] | pos->color[1];  
@@ -379,7 +492,7 @@ static u64 generatePinnedPiecesColor(Position* pos, i32 turn){
 
     // Now get all pieces under attack as if king is queen again and these are the possible pinners
     h_attack_mask = rookAttacks(all_pieces & ~pinned & ~ep_pawn_square, k_square);
-    pos_pinners = h_attack_mask & (pos->queen[!turn] | pos->rook[!turn]);
+    pos_pinners = h_attack_mask & (pos->pieces[!turn][QUEEN] | pos->pieces[!turn][ROOK]);
     while(pos_pinners){
         i32 pinner_sq = getlsb(pos_pinners);
         pin_directions |= betweenMask[k_square][pinner_sq];
@@ -387,7 +500,7 @@ static u64 generatePinnedPiecesColor(Position* pos, i32 turn){
     }
 
     d_attack_mask = bishopAttacks(all_pieces & ~pinned, k_square);
-    pos_pinners = d_attack_mask & (pos->queen[!turn] | pos->bishop[!turn]);
+    pos_pinners = d_attack_mask & (pos->pieces[!turn][QUEEN] | pos->pieces[!turn][BISHOP]);
     while(pos_pinners){
         i32 pinner_sq = getlsb(pos_pinners);
         pin_directions |= betweenMask[k_square][pinner_sq];
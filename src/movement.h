@@ -2,9 +2,25 @@
 #define MOVEMENT_H
 
 #include "types.h"
+
+// Generate the attack masks and pinned pieces in makeMove instead of on first use
+//#define EAGER_ATTACK_MASKS
+
 u16 generateLegalMoves(Position* pos,  Move* moveList);
 u16 generateThreatMoves(Position* pos,  Move* moveList);
+u16 generateCaptureMoves(Position* pos,  Move* moveList);
 u64 generatePinnedPieces(Position* pos);
-i32 makeMove(Position *pos, Move move);
-i32 makeNullMove(Position *pos);
+i32 makeMove(Position *pos, Move move, Undo *undo);
+i32 makeNullMove(Position *pos, Undo *undo);
+void unmakeMove(Position *pos, Move move, Undo *undo);
+void unmakeNullMove(Position *pos, Undo *undo);
+
+/* Returns the pinned pieces of both colors, generating them on the first call after a move */
+static inline u64 getPinnedPieces(Position* pos){
+    if(!(pos->lazy_valid & LAZY_PINNED)){
+        pos->pinned = generatePinnedPieces(pos);
+        pos->lazy_valid |= LAZY_PINNED;
+    }
+    return pos->pinned;
+}
 #endif
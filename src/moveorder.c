@@ -2,6 +2,7 @@
 #include "evaluator.h"
 #include "bitboard/bitboard.h"
 #include "types.h"
+#include "movement.h"
 
 /* Material Values for move ordering */
 const i32 MovePawnValue   =   1000;
@@ -30,6 +31,13 @@ static const i32 SEEPieceValues[] = {
 /* Sorting bonus for castling moves */
 const i32 MoveCastleBonus = 30;
 
+#define TT_MOVE_BONUS       3000000 // Bonus for move being in the TT
+#define CAPTURE_MOVE_BONUS  2000000 // Bonus for move being a capture
+#define KILLER_MOVE_BONUS   1000000 // Bonus for move being killer move
+
+#define HELPER_MOVE_DISORDER 3 // Increasing this changes how out of order helper searches look at moves
+#define HELPER_THREAD_DISORDER 3 // How different each helper thread searches from one another
+
 
 /*
  * Evaluates a move in a position
@@ -40,51 +48,50 @@ i32 eval_move(Move move, Position* pos){
     // Get the piece information from the move and the position.
     Square fr_sq = GET_FROM(move);
     Square to_sq = GET_TO(move);
-    char fr_piece = pos->charBoard[fr_sq];
-    char to_piece = pos->charBoard[to_sq];
-    i32 fr_piece_i = pieceToIndex[(int)fr_piece];
-    i32 to_piece_i = pieceToIndex[(int)to_piece];
+    PieceIndex fr_piece_i = pos->board[fr_sq];
+    PieceIndex to_piece_i = pos->board[to_sq];
 
     #ifdef DEBUG
-    if(fr_piece_i >= 12 || to_piece_i >= 12){
+    if(fr_piece_i >= NO_PIECE || to_piece_i > NO_PIECE){
         printf("Warning illegal piece found at:");
         printPosition(*pos, TRUE);
-        printf("from piece: %d", pos->charBoard[fr_sq]);
-        printf(" to piece: %d", pos->charBoard[to_sq]);
+        printf("from piece: %d", pos->board[fr_sq]);
+        printf(" to piece: %d", pos->board[to_sq]);
     }
     #endif
 
     // Add on the PST values
     u32 phase = pos->stage == END_GAME ? 1 : 0;
-    eval += PST[phase][fr_piece_i][to_sq] - PST[phase][fr_piece_i][fr_sq];
+    eval += pst_value(phase, fr_piece_i, to_sq) - pst_value(phase, fr_piece_i, fr_sq);
     
     // Add on calculated values depending on the flag
     switch(GET_FLAGS(move)){
         // Promotion Capture Moves
         case QUEEN_PROMO_CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveQueenValue - MovePawnValue;
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += pst_value(phase, to_piece_i, to_sq);
             break;
         case ROOK_PROMO_CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveRookValue - MovePawnValue;
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += pst_value(phase, to_piece_i, to_sq);
             break;
         case BISHOP_PROMO_CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveBishopValue - MovePawnValue;
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += pst_value(phase, to_piece_i, to_sq);
             break;
         case KNIGHT_PROMO_CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveKnightValue - MovePawnValue;
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += pst_value(phase, to_piece_i, to_sq);
             break;
         // Capture Moves
         case EP_CAPTURE:
-            eval += see(pos, to_sq, ( WHITE_PAWN + ((pos->flags & TURN_MASK) * 6) ), fr_sq, fr_piece_i);
-            eval += PST[phase][to_piece_i][to_sq];
+            to_piece_i = MAKE_PIECE(!(pos->flags & TURN_MASK), PAWN);
+            eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i);
+            eval += pst_value(phase, to_piece_i, to_sq);
             break;
         case CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i);
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += pst_value(phase, to_piece_i, to_sq);
             break;
         // Promotion Moves
         case QUEEN_PROMOTION:
@@ -116,42 +123,41 @@ i32 eval_move(Move move, Position* pos){
  * Used in the q-search.
  */
 void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size){
+    u32 phase = pos->stage == END_GAME ? 1 : 0;
     for(i32 i = 0; i < size; i++){
         moveVals[i] = 0;
         Move move = moveList[i];
         Square fr_sq = GET_FROM(move);
         Square to_sq = GET_TO(move);
 
-        i32 fr_piece = (i32)pos->charBoard[fr_sq];
-        i32 to_piece = (i32)pos->charBoard[to_sq];
-
-        i32 fr_piece_i = pieceToIndex[fr_piece];
-        i32 to_piece_i = pieceToIndex[to_piece];
+        PieceIndex fr_piece_i = pos->board[fr_sq];
+        PieceIndex to_piece_i = pos->board[to_sq];
 
         switch(GET_FLAGS(move)){
             case QUEEN_PROMO_CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveQueenValue;
-                moveVals[i] += PST[pos->stage][to_piece_i][to_sq];
+                moveVals[i] += pst_value(phase, to_piece_i, to_sq);
                 break;
             case ROOK_PROMO_CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveRookValue;
-                moveVals[i] += PST[pos->stage][to_piece_i][to_sq];
+                moveVals[i] += pst_value(phase, to_piece_i, to_sq);
                 break;
             case BISHOP_PROMO_CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveBishopValue;
-                moveVals[i] += PST[pos->stage][to_piece_i][to_sq];
+                moveVals[i] += pst_value(phase, to_piece_i, to_sq);
                 break;
             case KNIGHT_PROMO_CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveKnightValue;
-                moveVals[i] += PST[pos->stage][to_piece_i][to_sq];
+                moveVals[i] += pst_value(phase, to_piece_i, to_sq);
                 break;
             case EP_CAPTURE:
-                moveVals[i] += see(pos, to_sq, ( WHITE_PAWN + ((pos->flags & TURN_MASK) * 6) ), fr_sq, fr_piece_i);
-                moveVals[i] += PST[pos->stage][to_piece_i][to_sq];
+                to_piece_i = MAKE_PIECE(!(pos->flags & TURN_MASK), PAWN);
+                moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i);
+                moveVals[i] += pst_value(phase, to_piece_i, to_sq);
                 break;
             case CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i);
-                moveVals[i] += PST[pos->stage][to_piece_i][to_sq];
+                moveVals[i] += pst_value(phase, to_piece_i, to_sq);
                 break;
             default:
                 break;
@@ -162,37 +168,14 @@ void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size){
 
 /* Helper function for the Static Exchange Evaluator */
 static u64 least_valuable_attacker(Position* pos, u64 attadef, Turn turn, PieceIndex* piece){
-    u64 subset = attadef & pos->pawn[turn]; // Pawn
-    if (subset){
-        *piece = WHITE_PAWN + 6*turn;
-        return subset & -subset;
-    }
-    subset = attadef & pos->knight[turn]; // Knight
-    if (subset){
-        *piece = WHITE_KNIGHT + 6*turn;
-        return subset & -subset;
-    }
-    subset = attadef & pos->bishop[turn]; // Bishops
-    if (subset){
-        *piece = WHITE_BISHOP + 6*turn;
-        return subset & -subset;
-    }
-    subset = attadef & pos->rook[turn]; // Rooks
-    if (subset){
-        *piece = WHITE_ROOK + 6*turn;
-        return subset & -subset;
-    }
-    subset = attadef & pos->queen[turn]; // Queens
-    if (subset){
-        *piece = WHITE_QUEEN + 6*turn;
-        return subset & -subset;
-    }
-    subset = attadef & pos->king[turn]; // Kings
-    if (subset){
-        *piece = WHITE_KING + 6*turn;
-        return subset & -subset;
+    for(PieceType type = PAWN; type <= KING; type++){
+        u64 subset = attadef & pos->pieces[turn][type];
+        if (subset){
+            *piece = MAKE_PIECE(turn, type);
+            return subset & -subset;
+        }
     }
-   return 0; // None were found
+    return 0; // None were found
 }
 
 /* 
@@ -202,7 +185,7 @@ static u64 least_valuable_attacker(Position* pos, u64 attadef, Turn turn, PieceI
 i32 see(Position* pos, u32 toSq, PieceIndex target, u32 frSq, PieceIndex aPiece){
     i32 gain[32], d = 0;
     Turn turn = pos->flags & TURN_MASK;
-    u64 mayXray = pos->pawn[0] | pos->pawn[1] | pos->bishop[0] | pos->bishop[1] | pos->rook[0] | pos->rook[1] | pos->queen[0] | pos->queen[1];
+    u64 mayXray = pos->pieces[0][PAWN] | pos->pieces[1][PAWN] | pos->pieces[0][BISHOP] | pos->pieces[1][BISHOP] | pos->pieces[0][ROOK] | pos->pieces[1][ROOK] | pos->pieces[0][QUEEN] | pos->pieces[1][QUEEN];
     u64 removed = 0;
     u64 fromSet = 1ULL << frSq;
     u64 attadef = getAttackers(pos, toSq, 0) | getAttackers(pos, toSq, 1);
@@ -221,4 +204,161 @@ i32 see(Position* pos, u32 toSq, PieceIndex target, u32 frSq, PieceIndex aPiece)
         if(gain[d] >= -gain[d-1]) gain[d-1] = -gain[d];
     }
     return gain[0];
-}
\ No newline at end of file
+}
+/*
+ * Staged move picker
+ */
+void init_move_picker(MovePicker* mp, Move ttMove, KillerMoves* km, u32 ply, u32 thread_num){
+    mp->km = km;
+    mp->ttMove = ttMove;
+    mp->size = 0;
+    mp->end = 0;
+    mp->idx = 0;
+    mp->capture_end = 0;
+    mp->quiets_generated = FALSE;
+    mp->killer_idx = 0;
+    mp->ply = ply;
+    mp->thread_num = thread_num;
+    mp->stage = PICK_TT_MOVE;
+}
+
+/* Scores moves [from, to) of the picker, helper threads add some disorder */
+static inline void score_moves(MovePicker* mp, Position* pos, u32 from, u32 to, i32 bonus){
+    i32 thread_dif = (mp->thread_num % 2) ? -1 : 1;
+    for(u32 i = from; i < to; i++){
+        mp->moveVals[i] = eval_move(mp->moveList[i], pos) + bonus;
+        if(mp->thread_num){
+            mp->moveVals[i] += ((i32)i * HELPER_MOVE_DISORDER) + (thread_dif * (i32)mp->thread_num * HELPER_THREAD_DISORDER);
+        }
+    }
+}
+
+/* Swaps the best move in [idx, end) into idx and hands it out */
+static inline Move pick_best(MovePicker* mp, u32 end, i32* moveVal){
+    u32 maxIdx = mp->idx;
+    for(u32 j = mp->idx + 1; j < end; j++){
+        if(mp->moveVals[j] > mp->moveVals[maxIdx]) maxIdx = j;
+    }
+
+    Move move = mp->moveList[maxIdx];
+    i32 val = mp->moveVals[maxIdx];
+    mp->moveList[maxIdx] = mp->moveList[mp->idx];
+    mp->moveVals[maxIdx] = mp->moveVals[mp->idx];
+    mp->moveList[mp->idx] = move;
+    mp->moveVals[mp->idx] = val;
+    mp->idx++;
+
+    *moveVal = val;
+    return move;
+}
+
+/* Keeps the captures and promotions (or only the quiet moves) of the first size moves, the TT move is always dropped */
+static inline u32 filter_moves(MovePicker* mp, u32 size, u8 captures){
+    u32 kept = 0;
+    for(u32 i = 0; i < size; i++){
+        Move move = mp->moveList[i];
+        u8 is_capture = GET_FLAGS(move) >= CAPTURE;
+        if(move == mp->ttMove || is_capture != captures) continue;
+        mp->moveList[kept++] = move;
+    }
+    return kept;
+}
+
+/*
+ * Generates the captures and promotions, out of check only those so a cut on one never pays for the quiet moves
+ * In check the evasions are few, so they are generated in one go with the captures and promotions put first
+ */
+static inline void generate_captures(MovePicker* mp, Position* pos){
+    if(!(pos->flags & IN_CHECK)){
+        mp->end = filter_moves(mp, generateCaptureMoves(pos, mp->moveList), TRUE);
+        mp->capture_end = mp->end;
+        return;
+    }
+
+    mp->size = generateLegalMoves(pos, mp->moveList);
+    mp->end = mp->size;
+    for(u32 i = 0; i < mp->end; i++){
+        if(mp->moveList[i] == mp->ttMove){
+            mp->moveList[i] = mp->moveList[--mp->end];
+            break;
+        }
+    }
+
+    u32 capture_end = 0;
+    for(u32 i = 0; i < mp->end; i++){
+        if(GET_FLAGS(mp->moveList[i]) >= CAPTURE){
+            Move temp = mp->moveList[capture_end];
+            mp->moveList[capture_end++] = mp->moveList[i];
+            mp->moveList[i] = temp;
+        }
+    }
+    mp->capture_end = capture_end;
+    mp->quiets_generated = TRUE;
+}
+
+/* Replaces the handed out captures with the quiet moves, size then counts every legal move */
+static inline void generate_quiets(MovePicker* mp, Position* pos){
+    if(mp->quiets_generated) return;
+    mp->size = generateLegalMoves(pos, mp->moveList);
+    mp->end = filter_moves(mp, mp->size, FALSE);
+    mp->idx = 0;
+    mp->quiets_generated = TRUE;
+}
+
+/*
+ * Returns the next move to search, or NO_MOVE when there are none left.
+ * moveVal is set to the score the move was ordered by
+ */
+Move next_move(MovePicker* mp, Position* pos, i32* moveVal){
+    switch(mp->stage){
+        case PICK_TT_MOVE:
+            mp->stage = PICK_GEN_CAPTURES;
+            if(mp->ttMove != NO_MOVE){
+                if(isLegalMove(pos, mp->ttMove)){
+                    *moveVal = TT_MOVE_BONUS;
+                    return mp->ttMove;
+                }
+                mp->ttMove = NO_MOVE;
+            }
+            // Fall through
+        case PICK_GEN_CAPTURES:
+            generate_captures(mp, pos);
+            score_moves(mp, pos, 0, mp->capture_end, CAPTURE_MOVE_BONUS);
+            mp->stage = PICK_CAPTURES;
+            // Fall through
+        case PICK_CAPTURES:
+            if(mp->idx < mp->capture_end) return pick_best(mp, mp->capture_end, moveVal);
+            mp->stage = PICK_GEN_QUIETS;
+            // Fall through
+        case PICK_GEN_QUIETS:
+            generate_quiets(mp, pos); // Killers are quiet, they are looked up in the generated list
+            mp->stage = PICK_KILLERS;
+            // Fall through
+        case PICK_KILLERS:
+            while(mp->km && mp->killer_idx < KMV_CNT){
+                Move killer = mp->km->table[mp->ply][mp->killer_idx++];
+                if(killer == NO_MOVE || killer == mp->ttMove) continue;
+                for(u32 j = mp->idx; j < mp->end; j++){
+                    if(mp->moveList[j] == killer){
+                        mp->moveList[j] = mp->moveList[mp->idx];
+                        mp->moveList[mp->idx++] = killer;
+                        *moveVal = KILLER_MOVE_BONUS;
+                        return killer;
+                    }
+                }
+            }
+            mp->stage = PICK_SCORE_QUIETS;
+            // Fall through
+        case PICK_SCORE_QUIETS:
+            score_moves(mp, pos, mp->idx, mp->end, 0);
+            mp->stage = PICK_QUIETS;
+            // Fall through
+        case PICK_QUIETS:
+            if(mp->idx < mp->end) return pick_best(mp, mp->end, moveVal);
+            mp->stage = PICK_DONE;
+            // Fall through
+        case PICK_DONE:
+        default:
+            return NO_MOVE;
+    }
+}
@@ -1,6 +1,41 @@
 #pragma once
 #include "types.h"
 
+typedef enum {
+    PICK_TT_MOVE,
+    PICK_GEN_CAPTURES,
+    PICK_CAPTURES,
+    PICK_GEN_QUIETS,
+    PICK_KILLERS,
+    PICK_SCORE_QUIETS,
+    PICK_QUIETS,
+    PICK_DONE
+} PickStage;
+
+/*
+ * Hands out the moves of a node one at a time: the TT move before anything is generated,
+ * then captures and promotions, then killers, then the remaining quiet moves.
+ * Out of check the quiet moves are only generated once the captures run out, each stage is only scored once it is reached.
+ */
+typedef struct {
+    Move moveList[MAX_MOVES];
+    i32 moveVals[MAX_MOVES];
+    KillerMoves* km;
+    Move ttMove;
+    u32 size;        // Number of legal moves, set once the quiet moves are generated
+    u32 end;         // End of the move list, the TT move is taken out of it
+    u32 idx;         // Next move in the list to hand out
+    u32 capture_end; // Moves before this are captures and promotions
+    u8 quiets_generated; // The list holds the quiet moves, before that only captures and promotions
+    u32 killer_idx;
+    u32 ply;
+    u32 thread_num;  // Helper threads get a slightly different order
+    PickStage stage;
+} MovePicker;
+
 i32 eval_move(Move move, Position* pos);
 i32 see(Position* pos, u32 toSq, PieceIndex target, u32 frSq, PieceIndex aPiece);
-void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size);
\ No newline at end of file
+void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size);
+
+void init_move_picker(MovePicker* mp, Move ttMove, KillerMoves* km, u32 ply, u32 thread_num);
+Move next_move(MovePicker* mp, Position* pos, i32* moveVal);
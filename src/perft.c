@@ -0,0 +1,180 @@
+#include "perft.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "types.h"
+#include "util.h"
+#include "hash.h"
+#include "movement.h"
+
+#define PERFT_DEPTH_BITS 8
+#define PERFT_DEPTH_MASK ((1ULL << PERFT_DEPTH_BITS) - 1)
+
+/*
+ * Perft hash entry, the key is stored XORed with the data so a torn write
+ * from another thread reads back as a miss instead of a wrong count
+ */
+typedef struct {
+    _Atomic u64 key;
+    _Atomic u64 data; // Node count above PERFT_DEPTH_BITS, depth below
+} PerftEntry;
+
+static PerftEntry* perft_table = NULL;
+static u64 perft_mask = 0;
+
+typedef struct {
+    Position pos;         // Own copy of the root, with its own hash stack
+    Move* moves;          // Root moves shared by every worker
+    u64* counts;          // Node count for each root move
+    i32 size;
+    i32 depth;
+    _Atomic i32* next;    // Next root move to hand out
+} PerftWorker;
+
+static u8 probe_perft(u64 hash, i32 depth, u64* nodes){
+    PerftEntry* entry = &perft_table[hash & perft_mask];
+    u64 data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+    u64 key  = atomic_load_explicit(&entry->key,  memory_order_relaxed);
+    if((key ^ data) != hash || (i32)(data & PERFT_DEPTH_MASK) != depth) return FALSE;
+    *nodes = data >> PERFT_DEPTH_BITS;
+    return TRUE;
+}
+
+static void store_perft(u64 hash, i32 depth, u64 nodes){
+    PerftEntry* entry = &perft_table[hash & perft_mask];
+    u64 data = (nodes << PERFT_DEPTH_BITS) | (u64)depth;
+    atomic_store_explicit(&entry->key,  hash ^ data, memory_order_relaxed);
+    atomic_store_explicit(&entry->data, data,        memory_order_relaxed);
+}
+
+/*
+ * Counts the leaf nodes at depth, the last ply is bulk counted from the legal move list
+ */
+u64 perft(i32 depth, Position* pos){
+    Move move_list[MAX_MOVES];
+    u64 nodes = 0;
+
+    if (depth == 0) 
+        return 1ULL;
+
+    if (perft_table && depth > 1 && probe_perft(pos->hash, depth, &nodes))
+        return nodes;
+
+    i32 n_moves = generateLegalMoves(pos, move_list);
+    #ifndef PYTHON
+    if (depth == 1)
+        return n_moves;
+    #endif
+
+    Undo undo;
+    for (i32 i = 0; i < n_moves; i++) {
+        makeMove(pos, move_list[i], &undo);
+
+        #ifdef PYTHON
+        checkMoveCount(*pos);
+        #endif
+        nodes += perft(depth - 1, pos);
+        unmakeMove(pos, move_list[i], &undo);
+    }
+
+    if (perft_table && depth > 1) store_perft(pos->hash, depth, nodes);
+    return nodes;
+}
+
+/*
+ * Copies a position with a hash stack of its own, so threads do not share repetition history
+ */
+static Position clone_position(Position* pos){
+    Position copy = *pos;
+    copy.hashStack = createHashStack();
+    memcpy(copy.hashStack.ptr, pos->hashStack.ptr, sizeof(u64)*HASHSTACK_SIZE);
+    return copy;
+}
+
+static void* perft_worker_entry(void* arg){
+    PerftWorker* worker = (PerftWorker*)arg;
+    Undo undo;
+    i32 i;
+    while((i = atomic_fetch_add(worker->next, 1)) < worker->size){
+        makeMove(&worker->pos, worker->moves[i], &undo);
+        worker->counts[i] = perft(worker->depth - 1, &worker->pos);
+        unmakeMove(&worker->pos, worker->moves[i], &undo);
+    }
+    return NULL;
+}
+
+static i32 alloc_perft_table(u32 hash_mb){
+    u64 entries = 1;
+    while (entries * 2 * sizeof(PerftEntry) <= (u64)hash_mb << 20) entries <<= 1;
+    perft_table = calloc(entries, sizeof(PerftEntry));
+    if(!perft_table){
+        printf("info string Warning failed to allocate the perft hash table\n");
+        return -1;
+    }
+    perft_mask = entries - 1;
+    return 0;
+}
+
+/*
+ * Runs perft from pos, splitting the root moves across threads, and prints the node count and speed.
+ * With divide the count below each root move is printed as well
+ */
+i32 run_perft(Position* pos, i32 depth, u32 num_threads, u32 hash_mb, u8 divide){
+    Move moves[MAX_MOVES];
+    u64 counts[MAX_MOVES] = {0};
+    PerftWorker workers[PERFT_MAX_THREADS];
+    pthread_t threads[PERFT_MAX_THREADS];
+    _Atomic i32 next = 0;
+
+    if(depth < 1) depth = 1;
+    num_threads = MAX(1, MIN(num_threads, PERFT_MAX_THREADS));
+    if(hash_mb && alloc_perft_table(hash_mb)) return -1;
+
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    i32 size = generateLegalMoves(pos, moves);
+    for(u32 t = 0; t < num_threads; t++){
+        workers[t].pos    = clone_position(pos);
+        workers[t].moves  = moves;
+        workers[t].counts = counts;
+        workers[t].size   = size;
+        workers[t].depth  = depth;
+        workers[t].next   = &next;
+    }
+    u32 started = 1;
+    for(; started < num_threads; started++){
+        if(pthread_create(&threads[started], NULL, perft_worker_entry, &workers[started])){
+            printf("info string Warning failed to create perft thread %d\n", started);
+            break;
+        }
+    }
+    perft_worker_entry(&workers[0]);
+    for(u32 t = 1; t < started; t++){
+        pthread_join(threads[t], NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    u64 nodes = 0;
+    char moveStr[6];
+    for(i32 i = 0; i < size; i++){
+        nodes += counts[i];
+        if(divide){
+            moveToString(moves[i], moveStr);
+            printf("%s: %llu\n", moveStr, (unsigned long long)counts[i]);
+        }
+    }
+    double elapsed = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    printf("info string perft depth %d nodes %llu time %llu nps %llu threads %u hash %u\n", depth,
+        (unsigned long long)nodes, (unsigned long long)(elapsed * 1000),
+        (unsigned long long)(elapsed > 0 ? nodes / elapsed : 0), started, hash_mb);
+    fflush(stdout);
+
+    for(u32 t = 0; t < num_threads; t++) remove_hash_stack(&workers[t].pos.hashStack);
+    free(perft_table);
+    perft_table = NULL;
+    return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef PERFT_H
+#define PERFT_H
+#include "types.h"
+
+#define PERFT_MAX_THREADS 64
+
+u64 perft(i32 depth, Position* pos);
+i32 run_perft(Position* pos, i32 depth, u32 num_threads, u32 hash_mb, u8 divide);
+#endif
@@ -10,29 +10,39 @@
 #include "pthread.h"
 #include "types.h"
 #include "util.h"
+#include "hash.h"
+#include "transposition.h"
 
 #ifdef DEBUG
 #include <stdio.h>
 #endif
 
 _Atomic volatile u8 is_searching;          // Flag for if search loop is running
-_Atomic volatile u8 is_helpers_searching;  // Flag for if helper loop is running
 _Atomic volatile u8 can_shorten;           // Flag for if can leave before timer finishes
 _Atomic volatile u8 print_on_depth;        // Flag for whether or not to print when expected depth is reached
 
 // Search Parameters
-_Atomic volatile u8  helpers_run;
-_Atomic volatile u32 helpers_search_depth;
-_Atomic volatile i32 helper_eval;
-
 _Atomic volatile u32 search_depth;
 _Atomic volatile u32 search_time;
 _Atomic volatile u64 start_time;
+_Atomic volatile u64 node_limit;     // Stop once all threads together searched this many nodes, 0 for none
+_Atomic volatile u64 hard_deadline;  // millis() at which the search stops even without the timer, 0 for none
+
+// Per thread node totals, padded to a cache line each so counting a node never contends with another thread
+typedef struct {
+    _Alignas(64) _Atomic u64 nodes;
+} ThreadNodes;
 
+static ThreadNodes thread_nodes[MAX_THREADS];
+static _Atomic u32 searching_threads; // Thread count of the current search
 
-pthread_mutex_t helper_lock = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t helper_cond = PTHREAD_COND_INITIALIZER;
-int do_helper_search = FALSE;
+/*
+ * Lazy SMP depth skipping, helper thread i skips a depth when ((depth + SkipPhase[i]) / SkipSize[i]) is odd
+ * so the helpers spread out over the current and next iterations instead of all searching the same one
+ */
+#define SKIP_PATTERN_SIZE 20
+static const u8 SkipSize[SKIP_PATTERN_SIZE]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static const u8 SkipPhase[SKIP_PATTERN_SIZE] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
 
 #define SEARCH_REDUCTION_LEVEL 0.75    // How much time is reduced when search finds move to reduce time on
 #define SEARCH_EXTENSION_LEVEL 1.5     // How much time is expanded when search finds move to extend time on
@@ -44,28 +54,38 @@ int do_helper_search = FALSE;
 * Called from the IO Thread
 */
 void start_search(SearchParameters params){
+    stopTimer();            // Park the workers of any earlier search before changing its parameters
+    waitSearchThreads();
+    reset_global_pv_data(); // Every go reports its own iterations from depth 1
+    tt_new_search();        // Age the entries left by earlier searches
+
     is_searching   = FALSE; // Set up new search
-    print_on_depth = FALSE;
+    print_on_depth = !params.max_time && params.depth != MAX_DEPTH; // A depth based search prints its move when the depth is reached
 
     search_depth = params.depth;
     search_time  = params.rec_time;
     start_time   = millis();
     can_shorten  = params.can_shorten;
-    
-    start_search_threads(); // Launch Threads
+    node_limit   = params.max_nodes;
+    hard_deadline = params.max_time ? start_time + params.max_time : 0;
+    searching_threads = get_num_threads();
+    for(u32 i = 0; i < MAX_THREADS; i++){ // Before the wake, the first report would otherwise sum counts left by the last go
+        atomic_store_explicit(&thread_nodes[i].nodes, 0, memory_order_relaxed);
+    }
+
+    start_search_threads(); // Wake the workers, every parameter above must be set by now
 
     if(params.max_time){ // If a time has been set setup the timer (Under a second the timer will not have time to launch)
         #ifdef DEBUG
         printf("info string Starting timer with max time: %d\n", params.max_time);
         #endif
-        startTimerThread(params.max_time);
-    } else if (params.depth != MAX_DEPTH){ // If we are in a depth based search we want to setup to print move 
-        print_on_depth = TRUE;
+        startTimer(params.max_time);
     }
 }
 
 /*
  * Called from the timer thread when the search times out
+ * Runs with the timer lock held, start_search disarms the timer before resetting the search so a fire never reaches a newer search
  */
 void search_timed_out(void){
     if(best_move_found == FALSE){
@@ -79,7 +99,7 @@ void search_timed_out(void){
         printf("info string Max time hit stopping search\n");
         #endif
         stopSearchThreads();
-        print_best_move = TRUE;
+        post_print(PRINT_BEST_MOVE);
     }
     else{
         printf("info string Warning: Timer finished but no search is running or move is found!\n");
@@ -95,47 +115,73 @@ void stopSearch(){
     printf("info string Stop search called, stopping search and timer threads\n");
     #endif
     stopSearchThreads();
-    stopTimerThread();
+    stopTimer();
     #ifdef DEBUG
     printf("info string Stop search completed, search and timer threads closed\n");
     #endif
 }
 
 /*
- * Resumes the helpers at the current depth and ecal
+ * Nodes searched by every thread since the search started
  */
-static inline void resume_helpers(i32 depth, i32 eval){
-    pthread_mutex_lock(&helper_lock);
-    helpers_search_depth = depth;
-    helper_eval = eval;
-    do_helper_search = TRUE;
-    pthread_cond_broadcast(&helper_cond);  // Change this line
-    pthread_mutex_unlock(&helper_lock);
+static u64 searched_nodes(){
+    u64 nodes = 0;
+    u32 num_threads = searching_threads;
+    for(u32 i = 0; i < num_threads; i++){
+        nodes += atomic_load_explicit(&thread_nodes[i].nodes, memory_order_relaxed);
+    }
+    return nodes;
 }
 
-static inline void stop_helpers(){
-    if(!helpers_run) return;
-    helpers_run = FALSE;
-    resume_helpers(0, MAX_DEPTH+1);
+/*
+ * Stats of the whole search, the node count is summed over every thread and the time runs from the go command
+ */
+SearchStats aggregate_search_stats(void){
+    SearchStats stats = {0};
+    stats.node_count = searched_nodes();
+    stats.elap_time  = (double)(millis() - start_time) / 1000.0;
+    return stats;
 }
 
-static inline void helper_wait(){ // TODO: abstract away in threads.h or something for windows
-    pthread_mutex_lock(&helper_lock);
-    do_helper_search = FALSE;
-    while (!do_helper_search) pthread_cond_wait(&helper_cond, &helper_lock); // Block until the helpers are released
-    pthread_mutex_unlock(&helper_lock);
+/*
+ * Ends the search because a node or time limit was hit, only the first thread to notice prints the move
+ */
+static void search_limit_reached(){
+    if(atomic_exchange(&run_get_best_move, FALSE)){
+        stopTimer();
+        post_print(PRINT_BEST_MOVE);
+    }
+}
+
+/*
+ * Called from the tree every STOP_POLL_NODES nodes, returns true when the search should unwind
+ */
+u8 poll_search_stop(void){
+    if(!run_get_best_move) return TRUE;
+    if(!best_move_found) return FALSE; // Always finish the first iteration so there is a move to play
+    if(hard_deadline && millis() >= hard_deadline) search_limit_reached();
+    else if(node_limit && searched_nodes() >= node_limit) search_limit_reached();
+    return !run_get_best_move;
 }
 
+static inline u8 helper_skips_depth(u32 thread_num, u32 depth){
+    u32 i = (thread_num - 1) % SKIP_PATTERN_SIZE;
+    return ((depth + SkipPhase[i]) / SkipSize[i]) % 2;
+}
+
+/*
+ * Helper threads run their own iterative deepening on a copy of the position, skipping depths by thread number
+ * They only share results through the transposition table, the main thread reports the PV
+ */
 static void helper_loop(Position* pos, Move* pv_array, KillerMoves* km, u32 thread_num){
-    SearchStats stats;
-    helpers_run = TRUE;
-    helper_wait();
-    while(helpers_run && helpers_search_depth + (thread_num % 3) <= search_depth){
-        //printf("Helper thread searching at depth %d\n", helpers_search_depth + (thread_num % 3));
-        helper_search_tree(*pos, helpers_search_depth + (thread_num % 3), pv_array, km, helper_eval, &stats, thread_num);
-        helper_wait();
+    SearchStats stats = {0};
+    stats.thread_nodes = &thread_nodes[thread_num].nodes;
+    i32 eval = 0;
+    for(u32 depth = 1; run_get_best_move && depth <= search_depth; depth++){
+        if(helper_skips_depth(thread_num, depth)) continue;
+        eval = helper_search_tree(*pos, depth, pv_array, km, eval, &stats, thread_num);
+        if(stats.stopped) break;
     }
-    return;
 }
 
 /*
@@ -148,14 +194,15 @@ i32 search_loop(u32 thread_num){
     // Set up local thread info
     Move pv_array[MAX_DEPTH] = {0};
     KillerMoves km = {0};
+    bind_eval_cache(thread_num);
 
     if(search_depth == 0){
         printf("info string Warning search depth was 0\n");
         return -1;
     }
 
-    u32 cur_depth = (1 + (thread_num % NUM_MAIN_THREADS)) % search_depth;
-    u8 is_helper_thread = (thread_num >= NUM_MAIN_THREADS);
+    u32 cur_depth = 1;
+    u8 is_helper_thread = (thread_num != 0);
 
     Position search_pos = copy_global_position(); 
 
@@ -172,15 +219,17 @@ i32 search_loop(u32 thread_num){
 
     while(run_get_best_move && cur_depth <= search_depth){
 
-        SearchStats stats; // Set up for iteration
+        SearchStats stats = {0}; // Set up for iteration
+        stats.thread_nodes = &thread_nodes[thread_num].nodes;
         i32 avg_eval = 0;
         if(cur_depth >= 2) avg_eval = (found_eval[cur_depth-1] + found_eval[cur_depth-2]) / 2;
         TimePreference time_preference = NORMAL_TIME;
 
-        if(cur_depth > MIN_HELPER_DEPTH) resume_helpers(cur_depth, avg_eval); // Run Search
         found_eval[cur_depth] = search_tree(search_pos, cur_depth, pv_array, &km, avg_eval, &stats, &time_preference);
+        if(stats.stopped) break; // Unfinished iterations are thrown away
         found_move[cur_depth] = pv_array[0];
-        u8 updated = update_global_pv(cur_depth, pv_array, found_eval[cur_depth], stats);
+
+        u8 updated = update_global_pv(cur_depth, pv_array, found_eval[cur_depth], aggregate_search_stats());
 
         /*
          * Below here is my god awful time calculation code :) 
@@ -219,18 +268,18 @@ i32 search_loop(u32 thread_num){
         }
 
         if(can_shorten && updated && ((u32)(millis() - start_time) >= (search_time) / 2) ){ // If over 50% of the time has elapsed we stop the search
-            stopTimerThread();
+            stopTimer();
             run_get_best_move = FALSE;
-            print_best_move = TRUE;
+            post_print(PRINT_BEST_MOVE);
             break;
         }
         cur_depth++;
     }
-    stop_helpers();
 
     if(run_get_best_move && cur_depth > search_depth && print_on_depth){ // Print best move in the case we reached max depth
         print_on_depth = FALSE;
-        print_best_move = TRUE;
+        post_print(PRINT_BEST_MOVE);
+        run_get_best_move = FALSE; // The search is over, stop the helpers
     }
     #ifdef DEBUG
     printf("info string Completed search thread, freeing and exiting.\n");
@@ -239,13 +288,5 @@ i32 search_loop(u32 thread_num){
 exit_search_loop:
     remove_hash_stack(&search_pos.hashStack);
     is_searching = FALSE;
-    quit_thread();
     return 0;
 }
-
-//exit thread function
-void exit_search(Position* pos){
-   remove_hash_stack(&pos->hashStack);
-   is_searching = FALSE;
-   quit_thread();
-}
\ No newline at end of file
@@ -4,6 +4,7 @@
 void start_search(SearchParameters search);
 void search_timed_out(void);
 void stopSearch(void);
-void exit_search(Position* pos);
+u8 poll_search_stop(void);
+SearchStats aggregate_search_stats(void);
 i32 search_loop(u32 thread_num);
 #endif
\ No newline at end of file
@@ -1,16 +1,16 @@
 #include "tree.h"
 #include "types.h"
 #include "tables.h"
-//TODO: Both of these tables need to be modified to support threading.
+// Killer moves are owned by each search thread and passed down, history is thread local
 
 /*
 * Killer Moves
 */
 
 void storeKillerMove(KillerMoves* km, int ply, Move move){ 
-   if(GET_FLAGS(move) <= DOUBLE_PAWN_PUSH) return; // Killer moves arent quiet
+   if(GET_FLAGS(move) >= CAPTURE) return; // Killer moves are quiet, captures are already ordered first
    for(int i = 0; i < KMV_CNT; i++){
-      if(km->table[ply][km->kmvIdx] == move) return;
+      if(km->table[ply][i] == move) return;
    }
    km->table[ply][km->kmvIdx] = move;
    km->kmvIdx = (km->kmvIdx + 1) % KMV_CNT;
@@ -27,7 +27,7 @@ u8 isKillerMove(KillerMoves* km, Move move, int ply){ // TODO: Just get all thre
 /*
 * History Tables
 */
-static u32 historyTable[PLAYER_COUNT][BOARD_SIZE][BOARD_SIZE] = {0};
+static _Thread_local u32 historyTable[PLAYER_COUNT][BOARD_SIZE][BOARD_SIZE] = {0}; // One table per search thread
 
 void storeHistoryMove(char pos_flags, Move move, char depth){
    if(GET_FLAGS(move) & CAPTURE) return;
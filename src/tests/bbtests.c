@@ -15,22 +15,88 @@
 #include "../tree.h"
 #include "../movement.h"
 #include "../util.h"
+#include "../perft.h"
 #include "../hash.h"
 #include "../transposition.h"
 #include "../evaluator.h"
 #include "../globals.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
 #define MOVE_GEN_TEST
 #define MOVE_MAKE_TEST
 #define PERF_TEST
+#define SLIDER_TEST
+#define TT_FILE_TEST
+#if defined(__unix__) || defined(__APPLE__)
+#define SHARED_TT_TEST
+#endif
 //#define SEE_TEST
 //#define PUZZLE_TEST
 
+#ifdef MOVE_MAKE_TEST
+/* Compares everything unmakeMove is expected to restore */
+static i32 samePosition(Position* a, Position* b){
+    for(i32 i = 0; i < 2; i++){
+        if(a->pieces[i][PAWN] != b->pieces[i][PAWN] || a->pieces[i][BISHOP] != b->pieces[i][BISHOP] || a->pieces[i][KNIGHT] != b->pieces[i][KNIGHT] ||
+           a->pieces[i][ROOK] != b->pieces[i][ROOK] || a->pieces[i][QUEEN] != b->pieces[i][QUEEN] || a->pieces[i][KING] != b->pieces[i][KING] ||
+           a->attack_mask[i] != b->attack_mask[i] || a->color[i] != b->color[i]) return FALSE;
+    }
+    return a->en_passant == b->en_passant && a->flags == b->flags && a->pinned == b->pinned &&
+           a->checkers == b->checkers && a->lazy_valid == b->lazy_valid &&
+           a->hash == b->hash && a->pawn_hash == b->pawn_hash && memcmp(&a->accum, &b->accum, sizeof(EvalAccum)) == 0 && a->stage == b->stage &&
+           a->halfmove_clock == b->halfmove_clock && a->fullmove_number == b->fullmove_number &&
+           a->hash_stack_idx == b->hash_stack_idx &&
+           a->hashStack.current_idx == b->hashStack.current_idx &&
+           a->hashStack.last_reset_idx == b->hashStack.last_reset_idx &&
+           memcmp(a->board, b->board, sizeof(a->board)) == 0;
+}
+#endif
+
+#if defined(TT_FILE_TEST) || defined(SHARED_TT_TEST)
+#define TT_TEST_ENTRIES 1000
+#define TT_TEST_HASH(key) ((key) * 0x9E3779B97F4A7C15ULL)
+
+/* Stores the entries the TT tests look for, each field is derived from its key */
+static void storeTTTestEntries(void){
+    for(u64 key = 1; key <= TT_TEST_ENTRIES; key++) store_tt_entry(TT_TEST_HASH(key), key % 64, (i32)key, -(i32)key, PV_NODE, (Move)key);
+}
+
+/* Checks the entries from storeTTTestEntries, a few may have been replaced but none may be corrupted */
+static i32 verifyTTTestEntries(const char* found_msg){
+    i32 found = 0;
+    for(u64 key = 1; key <= TT_TEST_ENTRIES; key++){
+        i32 static_eval;
+        TTEntryData entry = get_tt_entry(TT_TEST_HASH(key), &static_eval);
+        if(entry.data && (entry.fields.eval != (i32)key || static_eval != -(i32)key || entry.fields.move != (Move)key)){
+            printf("TT entry does not match the stored one for key %d\n", (i32)key);
+            return -1;
+        }
+        found += entry.data != 0;
+    }
+    printf("Found %d of %d %s\n", found, TT_TEST_ENTRIES, found_msg);
+    return found < TT_TEST_ENTRIES * 9 / 10 ? -1 : 0;
+}
+#endif
+
 i32 testBB(void) {
     #ifdef PYTHON
     python_init();
     #endif
 
+    #ifdef SLIDER_TEST
+    printf("\n---------------------------------- SLIDER BACKEND TESTING ----------------------------------\n\n");
+    if(verifySliderBackends()){
+        printf("Slider backend verification failed!\n");
+        return -1;
+    }
+    benchSliderBackends();
+    printf("Slider backends verified.\n");
+    #endif
+
     #ifdef MOVE_GEN_TEST
     FILE *file;
     char line[1024];
@@ -88,14 +154,64 @@ i32 testBB(void) {
     printf("Starting Quick Check\n");
     Move threatMoveList[MAX_MOVES];
     i32 threatSize;
+    Move captureMoveList[MAX_MOVES];
+    i32 captureSize;
+    Undo undo;
     for(i32 j = 0; j < 100; j++){
         char* FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
         pos = fen_to_position(FEN);
         size = generateLegalMoves(&pos, moveList);
         while(size != 0 && pos.halfmove_clock < 50){
+            #ifdef MOVE_MAKE_TEST
+            Position prevPos = pos;
+            for(i32 k = 0; k < size; k++){
+                makeMove(&pos, moveList[k], &undo);
+                unmakeMove(&pos, moveList[k], &undo);
+                if(!samePosition(&pos, &prevPos)){
+                    printf("Unmake move did not restore the position for move: ");
+                    printMove(moveList[k]);
+                    printf("\n");
+                    printPosition(prevPos, TRUE);
+                    return -1;
+                }
+            }
+            makeNullMove(&pos, &undo);
+            unmakeNullMove(&pos, &undo);
+            if(!samePosition(&pos, &prevPos)){
+                printf("Unmake null move did not restore the position\n");
+                printPosition(prevPos, TRUE);
+                return -1;
+            }
+            #endif
             i32 randMove = rand() % size;
-            makeMove(&pos, moveList[randMove]);
+            makeMove(&pos, moveList[randMove], &undo);
+            Move staleMoveList[MAX_MOVES];
+            i32 staleSize = size;
+            memcpy(staleMoveList, moveList, size*sizeof(Move));
             size = generateLegalMoves(&pos, moveList);
+            for(i32 k = 0; k < size; k++){
+                if(!isLegalMove(&pos, moveList[k])){
+                    printf("Generated move rejected by isLegalMove: ");
+                    printMove(moveList[k]);
+                    printf("\n");
+                    printPosition(pos, TRUE);
+                    return -1;
+                }
+            }
+            // Moves from the previous position stand in for hash collisions in the TT
+            for(i32 k = 0; k < staleSize; k++){
+                char found = 0;
+                for(i32 l = 0; l < size; l++){
+                    if(staleMoveList[k] == moveList[l]) found = 1;
+                }
+                if(found != isLegalMove(&pos, staleMoveList[k])){
+                    printf("isLegalMove disagrees with the move generator for move: ");
+                    printMove(staleMoveList[k]);
+                    printf("\n");
+                    printPosition(pos, TRUE);
+                    return -1;
+                }
+            }
             threatSize = generateThreatMoves(&pos, threatMoveList);
             for(i32 k = 0; k < threatSize; k++){
                 char found = 0;
@@ -107,6 +223,29 @@ i32 testBB(void) {
                     return -1;
                 }
             }
+            // The move picker relies on the capture generator giving exactly the legal captures and promotions
+            captureSize = generateCaptureMoves(&pos, captureMoveList);
+            i32 legalCaptures = 0;
+            for(i32 l = 0; l < size; l++){
+                if(GET_FLAGS(moveList[l]) < CAPTURE) continue;
+                legalCaptures++;
+                char found = 0;
+                for(i32 k = 0; k < captureSize; k++){
+                    if(captureMoveList[k] == moveList[l]) found = 1;
+                }
+                if(!found){
+                    printf("Legal capture or promotion missing from capture moves: ");
+                    printMove(moveList[l]);
+                    printf("\n");
+                    printPosition(pos, TRUE);
+                    return -1;
+                }
+            }
+            if(captureSize != legalCaptures){
+                printf("Capture moves has %d moves but there are %d legal captures and promotions!\n", captureSize, legalCaptures);
+                printPosition(pos, TRUE);
+                return -1;
+            }
         }
         remove_hash_stack(&pos.hashStack);
     }
@@ -121,7 +260,7 @@ i32 testBB(void) {
     printf("Perft from default position:\n");
     pos = fen_to_position(START_FEN);
     for(i32 depth = 1; depth < 4; depth++){
-        u64 num_moves = perft(depth, pos);
+        u64 num_moves = perft(depth, &pos);
         printf("Perft output is %ld for depth %d\n", (long)num_moves, depth);
     }
     remove_hash_stack(&pos.hashStack);
@@ -139,8 +278,8 @@ i32 testBB(void) {
         pos = fen_to_position(fen);
         //printf("Testing: %s", fen);
         for(i32 depth = 1; depth < 2; depth++){
-            perft(depth, pos);
-            //i64 num_moves = perft(depth, pos);
+            perft(depth, &pos);
+            //i64 num_moves = perft(depth, &pos);
             //printf("D%d: %lld |", depth, (long long i32)num_moves);
         }
         remove_hash_stack(&pos.hashStack);
@@ -161,6 +300,7 @@ i32 testBB(void) {
     Move moveListNode[MAX_MOVES];
     i32 sizeNode = 0;
     i32 moveVals[MAX_MOVES] = {0};
+    Undo undoNode;
     sizeNode = generateLegalMoves(pos, moveListNode);
     evalMoves(moveListNode, moveVals, sizeNode, NO_MOVE, NULL, 0, pos);
     for(i32 i = 0; i < sizeNode; i++){
@@ -184,7 +324,7 @@ i32 testBB(void) {
         printMove(best_move);
         printf("Press Enter to Continue\n");
         while( getchar() != '\n' && getchar() != '\r');
-        makeMove(&pos, best_move);
+        makeMove(&pos, best_move, &undoNode);
         printf("Pos after move: \n");
         printPosition(pos, FALSE);
         best_move = getBestMove(pos);
@@ -201,13 +341,14 @@ i32 testBB(void) {
     Move moveList_hash[MAX_MOVES];
     i32 size_hash = 0;
     i32 moveVals[MAX_MOVES] = {0};
+    Undo undoHash;
     
 
     for (i32 i = 0; i < 100; i++)  {
         size_hash = generateLegalMoves(pos, moveList_hash);
         evalMoves(moveList_hash, moveVals, size_hash, NO_MOVE, NULL, 0, pos);
         select_sort(0, moveList_hash, moveVals, size_hash);
-        makeMove(&pos, moveList_hash[0]);
+        makeMove(&pos, moveList_hash[0], &undoHash);
         printf("Hash %d is: %" PRIu64 "\n", i+1, pos.hash);
     }
 
@@ -286,6 +427,46 @@ i32 testBB(void) {
     while( getchar() != '\n' && getchar() != '\r');
     #endif //SEE_TEST
 
+    #ifdef TT_FILE_TEST
+    printf("\n-------------------------------- TT FILE TESTING ----------------------------------\n\n");
+    const char* tt_path = "tt_file_test.hash";
+    if(init_tt(1, 1)) return -1;
+    storeTTTestEntries();
+    if(tt_save(tt_path)) return -1;
+    tt_clear(1);
+    if(tt_load(tt_path)){
+        remove(tt_path);
+        return -1;
+    }
+    remove(tt_path); // The copy on write mapping outlives the file name
+    if(verifyTTTestEntries("saved TT entries after reloading")) return -1;
+    if(init_tt(TT_DEFAULT_MB, 1)) return -1;
+    #endif
+
+    #ifdef SHARED_TT_TEST
+    printf("\n------------------------------- SHARED TT TESTING ---------------------------------\n\n");
+    char shm_name[64];
+    snprintf(shm_name, sizeof(shm_name), "godengine-test-%d", (i32)getpid());
+    if(init_tt_shared(shm_name, 1)) return -1;
+    fflush(stdout);
+    pid_t child = fork();
+    if(child == 0){ // A second process attaches by name and fills in entries
+        i32 status = init_tt_shared(shm_name, 1) ? 1 : 0;
+        if(!status) storeTTTestEntries();
+        fflush(stdout);
+        _exit(status);
+    }
+    i32 child_status = -1;
+    if(child < 0 || waitpid(child, &child_status, 0) != child || !WIFEXITED(child_status) || WEXITSTATUS(child_status)){
+        printf("Shared TT child process failed\n");
+        tt_unlink_shared(shm_name);
+        return -1;
+    }
+    tt_unlink_shared(shm_name);
+    if(verifyTTTestEntries("TT entries stored by the other process")) return -1;
+    if(init_tt(TT_DEFAULT_MB, 1)) return -1;
+    #endif
+
     #ifdef PYTHON
     python_close();
     #endif
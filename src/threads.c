@@ -1,4 +1,3 @@
-
 #include "threads.h"
 #include "types.h"
 #include "util.h"
@@ -6,8 +5,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
-#include <string.h>
-#include <stdio.h>
+#include <stdint.h>
 #include "globals.h"
 #include "search.h"
 #include "io.h"
@@ -16,112 +14,131 @@
 #include <unistd.h>
 #include <errno.h>
 
-static pthread_t search_threads[NUM_THREADS];
-
-// Global variable to control the timer thread
-pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t timer_cond = PTHREAD_COND_INITIALIZER;
-static pthread_t timerThread;
-
 /*
- * Quits out of a thread
+ * Search thread pool, workers are created once and park on pool_cond between searches
  */
-void quit_thread(){
-   pthread_exit(NULL);
-}
+static pthread_t search_threads[MAX_THREADS];
+static u32 pool_size = 0;                     // Workers created so far, the pool only grows
+static u32 busy_threads = 0;                  // Workers still running the current search
+static u64 search_generation = 0;             // Bumped for every search so a parked worker knows there is new work
+static u32 generation_threads = 0;            // How many workers take part in the current generation
+static u64 created_generation[MAX_THREADS];   // Generation each worker was created in, it waits for the next one
+static u8  pool_running = FALSE;
+static _Atomic u32 num_search_threads = 1;    // Set with the UCI Threads option
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_cond  = PTHREAD_COND_INITIALIZER;   // Signals workers a new search or shutdown
+static pthread_cond_t  idle_cond  = PTHREAD_COND_INITIALIZER;   // Signals the io thread the last worker finished
 
 /*
- * Starts a timer that prints out the best move and stops the search on completion
+ * Timer thread, sleeps until armed with a deadline and calls search_timed_out when it passes
+ * search_timed_out runs with timer_mutex held and must not block or call back into the timer
  */
-void* timerThreadFunction(void* duration_ms_ptr) {
+static pthread_t timer_thread;
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static struct timespec timer_deadline;
+static u8 timer_armed   = FALSE;
+static u8 timer_running = FALSE;
+
+static void* timer_thread_entry(void* arg) {
+    (void)arg;
     #ifdef DEBUG
-    printf("info string Running timer thread function\n");
+    printf("info string Timer thread running\n");
     fflush(stdout);
     #endif
 
-    i64 duration_ms = *(i64*)duration_ms_ptr;
-    free(duration_ms_ptr);
-
-    //Set up time to wait to
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec  += duration_ms / 1000;
-    ts.tv_nsec += (duration_ms % 1000) * 1000000;
-
-    u8 timed_out; // Whether or not to print after completion
-
     pthread_mutex_lock(&timer_mutex);
-    int result = pthread_cond_timedwait(&timer_cond, &timer_mutex, &ts);
-    
-    if (result == ETIMEDOUT) {
-        timed_out = TRUE;
-        #ifdef DEBUG
-        printf("info string Timer expired\n");
-        fflush(stdout);
-        #endif
-    } else {
-        timed_out = FALSE; // We dont want to print if manually stopped
-        #ifdef DEBUG
-        printf("info string Timer triggered early\n");
-        fflush(stdout);
-        #endif
+    while(timer_running){
+        if(!timer_armed){
+            pthread_cond_wait(&timer_cond, &timer_mutex);
+            continue;
+        }
+        i32 result = pthread_cond_timedwait(&timer_cond, &timer_mutex, &timer_deadline);
+        if(result == ETIMEDOUT && timer_armed){ // Not disarmed or rearmed while we slept
+            timer_armed = FALSE;
+            #ifdef DEBUG
+            printf("info string Timer expired\n");
+            fflush(stdout);
+            #endif
+            search_timed_out(); // Under the lock, so a start_search blocked in stopTimer cannot have its new search cancelled by this fire
+        }
     }
     pthread_mutex_unlock(&timer_mutex);
-    
-    
-    if(timed_out){ // Call the print function after waking up
-        search_timed_out();
-    }
-
-    #ifdef DEBUG
-    printf("info string timer thread function finished\n");
-    fflush(stdout);
-    #endif
-
-    return (void*)(i64)result;
+    return NULL;
 }
 
-i32 startTimerThread(i64 duration_ms) {
-    i64 *durationPtr = malloc(sizeof(i64));
+/*
+ * Arms the timer to stop the search after duration_ms
+ */
+i32 startTimer(i64 duration_ms) {
     #ifdef DEBUG
-    printf("info string Starting timer thread\n");
+    printf("info string Starting timer\n");
     fflush(stdout);
     #endif
 
-    if(!durationPtr){
-        printf("info string Warning failed to allocate space for duration pointer.\n");
+    pthread_mutex_lock(&timer_mutex);
+    if(!timer_running){
+        pthread_mutex_unlock(&timer_mutex);
+        printf("info string Warning timer thread is not running.\n");
         return -1;
     }
-    *durationPtr = duration_ms;
-    
-    if (pthread_create(&timerThread, NULL, timerThreadFunction, durationPtr)) {
-        perror("info string Failed to create timer thread\n");
-        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &timer_deadline);
+    timer_deadline.tv_sec  += duration_ms / 1000;
+    timer_deadline.tv_nsec += (duration_ms % 1000) * 1000000;
+    if(timer_deadline.tv_nsec >= 1000000000){
+        timer_deadline.tv_sec++;
+        timer_deadline.tv_nsec -= 1000000000;
     }
-    #ifdef DEBUG
-    printf("info string Timer thread started\n");
-    fflush(stdout);
-    #endif
+    timer_armed = TRUE;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_mutex);
     return 0;
 }
 
 /*
- * Cancels the timer thread
+ * Cancels the timer, we dont want to print if manually stopped
  */
-void stopTimerThread() {
+void stopTimer() {
     #ifdef DEBUG
-    printf("info string Stopping timer thread\n");
+    printf("info string Stopping timer\n");
     fflush(stdout);
     #endif
 
     pthread_mutex_lock(&timer_mutex);
-    pthread_cond_signal(&timer_cond);
+    timer_armed = FALSE;
+    if(timer_running) pthread_cond_signal(&timer_cond);
     pthread_mutex_unlock(&timer_mutex);
+}
 
-    #ifdef DEBUG
-    printf("info string Timer thread stopped\n");
-    fflush(stdout);
-    #endif
+static i32 start_timer_thread(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); // Deadlines are immune to wall clock changes
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    timer_running = TRUE;
+    if (pthread_create(&timer_thread, NULL, timer_thread_entry, NULL)) {
+        fprintf(stderr, "info string Error creating timer thread\n");
+        timer_running = FALSE;
+        return 1;
+    }
+    return 0;
+}
+
+static void stop_timer_thread(void) {
+    pthread_mutex_lock(&timer_mutex);
+    if(!timer_running){
+        pthread_mutex_unlock(&timer_mutex);
+        return;
+    }
+    timer_running = FALSE;
+    timer_armed = FALSE;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_mutex);
+    pthread_join(timer_thread, NULL);
+    pthread_cond_destroy(&timer_cond);
 }
 
 
@@ -147,33 +164,89 @@ void *output_thread_entry(void *arg) {
     return NULL;
 }
 
-void *search_thread_entry(void *arg) {
-    u32 thread_num = *(u32*)arg;
-    free(arg);
+/*
+ * Worker loop, parks until the generation changes then runs search_loop if it is part of that search
+ */
+static void *search_worker_entry(void *arg) {
+    u32 thread_num = (u32)(uintptr_t)arg;
 
     #ifdef DEBUG
-    printf("info string Search Thread Starting\n");
+    printf("info string Search worker %u starting\n", thread_num);
     fflush(stdout);
     #endif
 
-    search_loop(thread_num);
+    pthread_mutex_lock(&pool_mutex);
+    u64 seen_generation = created_generation[thread_num];
+    while(TRUE){
+        while(pool_running && seen_generation == search_generation) pthread_cond_wait(&pool_cond, &pool_mutex);
+        if(!pool_running) break;
+        seen_generation = search_generation;
+        if(thread_num >= generation_threads) continue; // Not needed for this search
+
+        pthread_mutex_unlock(&pool_mutex);
+        search_loop(thread_num);
+        pthread_mutex_lock(&pool_mutex);
+
+        if(--busy_threads == 0) pthread_cond_broadcast(&idle_cond);
+    }
+    pthread_mutex_unlock(&pool_mutex);
     return NULL;
 }
 
+/*
+ * Creates workers until the pool holds num_threads, must hold pool_mutex
+ */
+static void grow_thread_pool(u32 num_threads){
+    while(pool_size < num_threads){
+        created_generation[pool_size] = search_generation;
+        if(pthread_create(&search_threads[pool_size], NULL, search_worker_entry, (void*)(uintptr_t)pool_size)){
+            printf("info string Warning: failed to create search thread %u.\n", pool_size);
+            return;
+        }
+        pool_size++;
+    }
+}
+
+/*
+ * Sets how many threads the next search runs with, clamped to [1, MAX_THREADS]
+ */
+void set_num_threads(u32 num_threads){
+    num_search_threads = MIN(MAX(num_threads, 1), MAX_THREADS);
+}
+
+u32 get_num_threads(void){
+    return num_search_threads;
+}
+
+/*
+ * Stops the running search and blocks until every worker is parked again
+ */
+void waitSearchThreads(){
+    run_get_best_move = FALSE;
+    pthread_mutex_lock(&pool_mutex);
+    while(busy_threads) pthread_cond_wait(&idle_cond, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
 void start_search_threads(){
     #ifdef DEBUG
     printf("info string starting search threads\n");
     #endif
-    run_get_best_move = TRUE;
-    for (i32 i = 0; i < NUM_THREADS; i++) {
-        u32* thread_num = malloc(sizeof(u32));
-        if(!thread_num){
-            printf("info string Warning: failed to allocate memory in start search threads.\n");
-            return;
-        }
-        *thread_num = i;
-        pthread_create(&search_threads[i], NULL, search_thread_entry, thread_num);
+    waitSearchThreads();
+
+    pthread_mutex_lock(&pool_mutex);
+    if(!pool_running){
+        pthread_mutex_unlock(&pool_mutex);
+        printf("info string Warning: search thread pool is not running.\n");
+        return;
     }
+    grow_thread_pool(num_search_threads);
+    generation_threads = MIN(num_search_threads, pool_size);
+    busy_threads = generation_threads;
+    run_get_best_move = TRUE;
+    search_generation++;
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_mutex);
 }
 
 void stopSearchThreads(){
@@ -183,8 +256,33 @@ void stopSearchThreads(){
     run_get_best_move = false;
 }
 
+static i32 start_thread_pool(void){
+    pthread_mutex_lock(&pool_mutex);
+    pool_running = TRUE;
+    grow_thread_pool(num_search_threads);
+    i32 result = pool_size ? 0 : 1;
+    pthread_mutex_unlock(&pool_mutex);
+    return result;
+}
+
+static void stop_thread_pool(void){
+    waitSearchThreads();
+    pthread_mutex_lock(&pool_mutex);
+    pool_running = FALSE;
+    pthread_cond_broadcast(&pool_cond);
+    u32 num_threads = pool_size;
+    pool_size = 0;
+    pthread_mutex_unlock(&pool_mutex);
+    for(u32 i = 0; i < num_threads; i++) pthread_join(search_threads[i], NULL);
+}
+
 i32 launch_threads(void){
     pthread_t input_thread, output_thread;
+    if (start_thread_pool() || start_timer_thread()) {
+        fprintf(stderr, "info string Error creating search threads\n");
+        stop_thread_pool();
+        return 1;
+    }
     if (pthread_create(&input_thread, NULL, input_thread_entry, NULL)) {
         fprintf(stderr, "info string Error creating Input thread\n");
         return 1;
@@ -195,5 +293,7 @@ i32 launch_threads(void){
     }
     pthread_join(input_thread, NULL);
     pthread_join(output_thread, NULL);
+    stop_timer_thread();
+    stop_thread_pool();
     return 0;
 }
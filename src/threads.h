@@ -3,16 +3,14 @@
 #include "types.h"
 
 
-#define MIN_HELPER_DEPTH MAX_DEPTH // At what depth to launch helper threads
+#define MAX_THREADS 256 // Upper bound for the UCI Threads option, thread 0 is the main thread and the rest are helpers
 
-
-#define NUM_THREADS      1 // Total number of threads
-#define NUM_MAIN_THREADS 1 // How main of these are main threads (remaining will be helpers)
-
-i32 startTimerThread(i64 durationInSeconds);
-void stopTimerThread();
+i32 startTimer(i64 duration_ms);
+void stopTimer();
 void start_search_threads();
+void set_num_threads(u32 num_threads);
+u32 get_num_threads(void);
 void stopSearchThreads();
-void quit_thread();
+void waitSearchThreads();
 i32 launch_threads(void);
 #endif
\ No newline at end of file
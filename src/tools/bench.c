@@ -0,0 +1,326 @@
+//
+//  bench.c
+//  godengine
+//
+//  Standalone timings of the engine's hot primitives over the perft suite and ERET positions.
+//  Built with `make bench`, run from the repository root:
+//      ./src/craig-bench [-csv <file>] [-hash <MB>] [-evalcache <KB>] [epd files...]
+//  -hash sets the table size of the node rate search, build with PREFETCH_FLAGS=-DNO_PREFETCH to compare without prefetching.
+//  -evalcache sets the per thread eval cache of both searches, it is off by default as in the engine.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../types.h"
+#include "../util.h"
+#include "../hash.h"
+#include "../movement.h"
+#include "../moveorder.h"
+#include "../evaluator.h"
+#include "../transposition.h"
+#include "../tree.h"
+#include "../globals.h"
+#include "../bitboard/bitboard.h"
+#include "../bitboard/bbutils.h"
+#include "../bitboard/magic.h"
+
+#define MAX_BENCH_POSITIONS 2048
+#define MAX_EPD_FILES       8
+#define BENCH_MIN_NS        250000000.0 // Each primitive runs for at least this long
+#define BENCH_TT_MB         256         // Large enough that probes miss the cache like they do in search
+#define BENCH_TT_KEYS       (1 << 20)
+#define BENCH_SEARCH_MB     8           // Small enough that the searches below overfill it and replacement matters
+#define BENCH_SEARCH_DEPTH  7
+#define BENCH_SEARCH_POSITIONS 48
+#define BENCH_NPS_MB        1024        // Far past the last level cache, where every probe is a DRAM miss
+#define BENCH_LAZY_WINDOW   1000        // Lazy eval primitive searches (-a pawn, a pawn) around an even score
+
+typedef struct {
+    Position pos;
+    Move moves[MAX_MOVES];
+    i32 size;
+} BenchPosition;
+
+typedef struct {
+    const char* name;
+    double ns_per_op;
+    u64 ops;
+} BenchResult;
+
+static BenchPosition positions[MAX_BENCH_POSITIONS];
+static i32 num_positions = 0;
+static u64 tt_keys[BENCH_TT_KEYS];
+static volatile u64 sink; // Keeps the timed calls from being optimized out
+
+static double elapsed_ns(struct timespec* start, struct timespec* end){
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/*
+ * Reads the FEN part of each epd line, the first four fields, and fills in the move counters
+ */
+static i32 load_epd(const char* path){
+    char line[1024];
+    FILE* file = fopen(path, "r");
+    if(file == NULL){
+        char parent[512];
+        snprintf(parent, sizeof(parent), "../%s", path);
+        file = fopen(parent, "r");
+    }
+    if(file == NULL){
+        printf("info string Warning could not open %s\n", path);
+        return -1;
+    }
+
+    i32 loaded = 0;
+    while(num_positions < MAX_BENCH_POSITIONS && fgets(line, sizeof(line), file)){
+        char fen[256] = {0};
+        char* saveptr;
+        char* field = strtok_r(line, " ;\n", &saveptr);
+        for(i32 i = 0; i < 4 && field; i++){
+            strncat(fen, field, sizeof(fen) - strlen(fen) - 4);
+            strcat(fen, " ");
+            field = strtok_r(NULL, " ;\n", &saveptr);
+        }
+        if(strlen(fen) < 16) continue;
+        strcat(fen, "0 1");
+
+        BenchPosition* bp = &positions[num_positions++];
+        bp->pos  = fen_to_position(fen);
+        bp->size = generateLegalMoves(&bp->pos, bp->moves);
+        loaded++;
+    }
+    fclose(file);
+    printf("info string Loaded %d positions from %s\n", loaded, path);
+    return loaded;
+}
+
+/*
+ * Repeats body over every position until BENCH_MIN_NS has passed, ops is how many calls one pass makes
+ */
+#define RUN_BENCH(result, bench_name, ops_expr, ...) do {                   \
+    BenchResult* bench_result = &(result);                                  \
+    struct timespec start, end;                                             \
+    u64 ops = 0, pass_ops = 0;                                              \
+    for(i32 p = 0; p < num_positions; p++){                                 \
+        BenchPosition* bp = &positions[p];                                  \
+        (void)bp;                                                           \
+        pass_ops += (ops_expr);                                             \
+    }                                                                       \
+    clock_gettime(CLOCK_MONOTONIC, &start);                                 \
+    do {                                                                    \
+        for(i32 p = 0; p < num_positions; p++){                             \
+            BenchPosition* bp = &positions[p];                              \
+            (void)bp;                                                       \
+            __VA_ARGS__;                                                    \
+        }                                                                   \
+        ops += pass_ops;                                                    \
+        clock_gettime(CLOCK_MONOTONIC, &end);                               \
+    } while(elapsed_ns(&start, &end) < BENCH_MIN_NS);                       \
+    bench_result->name = bench_name;                                        \
+    bench_result->ops = ops;                                                \
+    bench_result->ns_per_op = ops ? elapsed_ns(&start, &end) / ops : 0;     \
+} while(0)
+
+/*
+ * Searches the first positions one after another, like consecutive moves sharing one table, and reports how well the TT held up
+ */
+static void bench_tt_search(FILE* csv, u64 size_mb){
+    if(init_tt(size_mb, online_cpus())){
+        printf("info string Warning failed to create transposition table for the search bench\n");
+        return;
+    }
+    tt_reset_stats();
+    pawn_hash_reset_stats();
+    eval_cache_reset_stats();
+    lazy_eval_reset_stats();
+    run_get_best_move = TRUE;
+
+    i32 count = MIN(num_positions, BENCH_SEARCH_POSITIONS);
+    u64 nodes = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i32 p = 0; p < count; p++){
+        Move pv_array[MAX_DEPTH] = {0};
+        KillerMoves km = {0};
+        SearchStats stats = {0};
+        tt_new_search();
+        for(u32 depth = 1; depth <= BENCH_SEARCH_DEPTH; depth++){
+            search_tree(positions[p].pos, depth, pv_array, &km, 0, &stats, NULL);
+            nodes += stats.node_count;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    run_get_best_move = FALSE;
+
+    TTStats tt = tt_stats();
+    CacheStats pawn = pawn_hash_stats();
+    double pawn_hit_rate = pawn.probes ? 100.0 * pawn.hits / pawn.probes : 0;
+    CacheStats eval_cache = eval_cache_stats();
+    double eval_hit_rate = eval_cache.probes ? 100.0 * eval_cache.hits / eval_cache.probes : 0;
+    LazyEvalStats lazy = lazy_eval_stats();
+    double lazy_rate = lazy.calls ? 100.0 * lazy.lazy / lazy.calls : 0;
+    double seconds = elapsed_ns(&start, &end) / 1e9;
+    double nps = seconds > 0 ? nodes / seconds : 0;
+    double hit_rate = tt.probes ? 100.0 * tt.hits / tt.probes : 0;
+    double entries_per_mb = (double)tt.entries / ((double)tt.size_bytes / (1 << 20));
+    unsigned long long mb = (unsigned long long)size_mb;
+    printf("\nTT search bench, %d positions to depth %d in %llu MB\n", count, BENCH_SEARCH_DEPTH, mb);
+    printf("%-24s %14.0f\n", "entries per MB", entries_per_mb);
+    printf("%-24s %14llu\n", "probes", (unsigned long long)tt.probes);
+    printf("%-24s %13.2f%%\n", "hit rate", hit_rate);
+    printf("%-24s %13.2f%%\n", "pawn hash hit rate", pawn_hit_rate);
+    printf("%-24s %13.2f%%\n", "eval cache hit rate", eval_hit_rate);
+    printf("%-24s %14llu\n", "eval calls", (unsigned long long)lazy.calls);
+    printf("%-24s %13.2f%%\n", "lazy eval rate", lazy_rate);
+    printf("%-24s %14llu\n", "nodes", (unsigned long long)nodes);
+    printf("%-24s %14.3f\n", "seconds", seconds);
+    printf("%-24s %14.0f\n", "nodes per second", nps);
+    fprintf(csv, "tt_entries_per_mb_%llumb,%.0f,,\ntt_hit_rate_%llumb,%.3f,%llu,%d\ntt_search_nodes_%llumb,%llu,,%d\ntt_search_nps_%llumb,%.0f,,%d\npawn_hash_hit_rate_%llumb,%.3f,%llu,%d\neval_cache_hit_rate_%llumb,%.3f,%llu,%d\nlazy_eval_rate_%llumb,%.3f,%llu,%d\n",
+            mb, entries_per_mb, mb, hit_rate, (unsigned long long)tt.probes, count,
+            mb, (unsigned long long)nodes, count, mb, nps, count,
+            mb, pawn_hit_rate, (unsigned long long)pawn.probes, count,
+            mb, eval_hit_rate, (unsigned long long)eval_cache.probes, count,
+            mb, lazy_rate, (unsigned long long)lazy.calls, count);
+    tt_free();
+}
+
+/* Captures with a piece on the target square, which is what see expects */
+static i32 is_capture(Move move){
+    u32 flags = GET_FLAGS(move);
+    return flags == CAPTURE || flags >= KNIGHT_PROMO_CAPTURE;
+}
+
+static i32 count_captures(BenchPosition* bp){
+    i32 count = 0;
+    for(i32 m = 0; m < bp->size; m++) count += is_capture(bp->moves[m]);
+    return count;
+}
+
+i32 main(i32 argc, char** argv){
+    const char* csv_path = NULL;
+    u64 nps_mb = BENCH_NPS_MB;
+    const char* epd_files[MAX_EPD_FILES];
+    i32 num_files = 0;
+
+    for(i32 i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-csv") == 0 && i + 1 < argc) csv_path = argv[++i];
+        else if(strcmp(argv[i], "-hash") == 0 && i + 1 < argc) nps_mb = strtoull(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "-evalcache") == 0 && i + 1 < argc) set_eval_cache_size(strtoull(argv[++i], NULL, 10));
+        else if(num_files < MAX_EPD_FILES) epd_files[num_files++] = argv[i];
+    }
+    if(num_files == 0){
+        epd_files[num_files++] = "perftsuite.epd";
+        epd_files[num_files++] = "puzzles/ERET.epd";
+    }
+
+    #ifdef RUNTIME_TABLES
+    generateMasks();
+    if(generateMagics()) return 1;
+    initZobrist();
+    init_pst();
+    init_lazy_margins();
+    init_masks();
+    #endif
+
+    for(i32 i = 0; i < num_files; i++) load_epd(epd_files[i]);
+    if(num_positions == 0){
+        printf("info string No positions to benchmark\n");
+        return 1;
+    }
+
+    if(init_tt(BENCH_TT_MB, online_cpus())){
+        printf("info string Warning failed to create transposition table, exiting.\n");
+        return 1;
+    }
+    srand(1);
+    for(i32 i = 0; i < BENCH_TT_KEYS; i++) tt_keys[i] = random_uint64();
+
+    BenchResult results[16];
+    i32 n = 0;
+    Move scratch[MAX_MOVES];
+    Undo undo;
+    u8 lazy;
+
+    // Attack masks and pins are computed lazily after each move, so clear them to time a fresh node
+    RUN_BENCH(results[n++], "generateLegalMoves", 1,
+        bp->pos.lazy_valid = 0; sink += generateLegalMoves(&bp->pos, scratch));
+
+    RUN_BENCH(results[n++], "generateThreatMoves", 1,
+        bp->pos.lazy_valid = 0; sink += generateThreatMoves(&bp->pos, scratch));
+
+    RUN_BENCH(results[n++], "generateCaptureMoves", 1,
+        bp->pos.lazy_valid = 0; sink += generateCaptureMoves(&bp->pos, scratch));
+
+    RUN_BENCH(results[n++], "makeMove+unmakeMove", bp->size,
+        for(i32 m = 0; m < bp->size; m++){
+            makeMove(&bp->pos, bp->moves[m], &undo);
+            sink += bp->pos.hash;
+            unmakeMove(&bp->pos, bp->moves[m], &undo);
+        });
+
+    RUN_BENCH(results[n++], "generatePinnedPieces", 1,
+        sink += generatePinnedPieces(&bp->pos));
+
+    RUN_BENCH(results[n++], "eval_position", 1,
+        bp->pos.lazy_valid = 0; sink += eval_position(&bp->pos, MIN_EVAL, MAX_EVAL, &lazy));
+
+    lazy_eval_reset_stats();
+    RUN_BENCH(results[n++], "eval_position_lazy", 1,
+        bp->pos.lazy_valid = 0; sink += eval_position(&bp->pos, -BENCH_LAZY_WINDOW, BENCH_LAZY_WINDOW, &lazy));
+    LazyEvalStats window_lazy = lazy_eval_stats();
+    double window_lazy_rate = window_lazy.calls ? 100.0 * window_lazy.lazy / window_lazy.calls : 0;
+
+    RUN_BENCH(results[n++], "eval_move", bp->size,
+        for(i32 m = 0; m < bp->size; m++) sink += eval_move(bp->moves[m], &bp->pos));
+
+    RUN_BENCH(results[n++], "see", count_captures(bp),
+        for(i32 m = 0; m < bp->size; m++){
+            if(!is_capture(bp->moves[m])) continue;
+            u32 fr_sq = GET_FROM(bp->moves[m]), to_sq = GET_TO(bp->moves[m]);
+            sink += see(&bp->pos, to_sq, bp->pos.board[to_sq], fr_sq, bp->pos.board[fr_sq]);
+        });
+
+    RUN_BENCH(results[n++], "store_tt_entry", BENCH_TT_KEYS / 64,
+        for(i32 k = (p % 64) * (BENCH_TT_KEYS / 64); k < (p % 64 + 1) * (BENCH_TT_KEYS / 64); k++)
+            store_tt_entry(tt_keys[k], 5, k, TT_NO_EVAL, PV_NODE, bp->moves[0]));
+
+    RUN_BENCH(results[n++], "get_tt_entry", BENCH_TT_KEYS / 64,
+        for(i32 k = (p % 64) * (BENCH_TT_KEYS / 64); k < (p % 64 + 1) * (BENCH_TT_KEYS / 64); k++)
+            sink += get_tt_entry(tt_keys[k], NULL).data);
+
+    RUN_BENCH(results[n++], "bishopAttacks", 64,
+        for(i32 sq = 0; sq < 64; sq++) sink += bishopAttacks(bp->pos.color[0] | bp->pos.color[1], sq));
+
+    RUN_BENCH(results[n++], "rookAttacks", 64,
+        for(i32 sq = 0; sq < 64; sq++) sink += rookAttacks(bp->pos.color[0] | bp->pos.color[1], sq));
+
+    printf("\n%-24s %12s %14s\n", "primitive", "ns/op", "ops");
+    for(i32 i = 0; i < n; i++){
+        printf("%-24s %12.2f %14llu\n", results[i].name, results[i].ns_per_op, (unsigned long long)results[i].ops);
+    }
+    printf("%-24s %11.2f%%\n", "lazy eval rate", window_lazy_rate);
+
+    FILE* csv = csv_path ? fopen(csv_path, "w") : stdout;
+    if(csv == NULL){
+        perror("Error opening csv file");
+        csv = stdout;
+    }
+    if(csv == stdout) printf("\n");
+    fprintf(csv, "primitive,ns_per_op,ops,positions\n");
+    for(i32 i = 0; i < n; i++){
+        fprintf(csv, "%s,%.3f,%llu,%d\n", results[i].name, results[i].ns_per_op, (unsigned long long)results[i].ops, num_positions);
+    }
+    fprintf(csv, "lazy_eval_rate_window,%.3f,%llu,%d\n", window_lazy_rate, (unsigned long long)window_lazy.calls, num_positions);
+    tt_free();
+    bind_eval_cache(0); // After the primitives, eval_position above times a full evaluation
+    bench_tt_search(csv, BENCH_SEARCH_MB);
+    bench_tt_search(csv, nps_mb);
+    if(csv != stdout) fclose(csv);
+
+    for(i32 p = 0; p < num_positions; p++) remove_hash_stack(&positions[p].pos.hashStack);
+    free_eval_caches();
+    return 0;
+}
@@ -0,0 +1,126 @@
+//
+//  gentables.c
+//  godengine
+//
+//  Fills every startup table with the runtime generators and writes them out as
+//  read only C definitions (precomputed.c). Built with -DRUNTIME_TABLES by `make tables`.
+//
+
+#include <stdio.h>
+#include "../types.h"
+#include "../bitboard/bitboard.h"
+#include "../bitboard/bbutils.h"
+#include "../bitboard/magic.h"
+#include "../hash.h"
+#include "../evaluator.h"
+#include "../masks.h"
+
+#define VALUES_PER_LINE 4
+
+/*
+ * Writes the nested initializer for an array of dims[0] x dims[1] x ... values
+ */
+static void emitValues(FILE* out, const void* data, i32 is64, const i32* dims, i32 ndims, i32* idx, i32 indent) {
+    fprintf(out, "{");
+    if (ndims == 1) {
+        for (i32 i = 0; i < dims[0]; i++, (*idx)++) {
+            if (i % VALUES_PER_LINE == 0) fprintf(out, "\n%*s", indent + 4, "");
+            if (is64) fprintf(out, "0x%016llxULL,", (unsigned long long)((const u64*)data)[*idx]);
+            else      fprintf(out, "%d,", ((const i32*)data)[*idx]);
+            if (i % VALUES_PER_LINE != VALUES_PER_LINE - 1 && i != dims[0] - 1) fprintf(out, " ");
+        }
+    } else {
+        for (i32 i = 0; i < dims[0]; i++) {
+            fprintf(out, "\n%*s", indent + 4, "");
+            emitValues(out, data, is64, dims + 1, ndims - 1, idx, indent + 4);
+            fprintf(out, ",");
+        }
+    }
+    fprintf(out, "\n%*s}", indent, "");
+}
+
+static void emitArray(FILE* out, const char* type, const char* name, const void* data, i32 is64, const i32* dims, i32 ndims) {
+    i32 idx = 0;
+    fprintf(out, "const %s %s", type, name);
+    for (i32 i = 0; i < ndims; i++) fprintf(out, "[%d]", dims[i]);
+    fprintf(out, " = ");
+    emitValues(out, data, is64, dims, ndims, &idx, 0);
+    fprintf(out, ";\n\n");
+}
+
+#define EMIT_U64(out, name, ...) emitArray(out, "u64", #name, name, TRUE, (const i32[]){__VA_ARGS__}, sizeof((i32[]){__VA_ARGS__}) / sizeof(i32))
+#define EMIT_I32(out, name, ...) emitArray(out, "i32", #name, name, FALSE, (const i32[]){__VA_ARGS__}, sizeof((i32[]){__VA_ARGS__}) / sizeof(i32))
+#define EMIT_SCORE(out, name, ...) emitArray(out, "Score", #name, name, FALSE, (const i32[]){__VA_ARGS__}, sizeof((i32[]){__VA_ARGS__}) / sizeof(i32))
+
+static void emitMagics(FILE* out, const char* name, const SMagic* table) {
+    fprintf(out, "const SMagic %s[64] = {\n", name);
+    for (i32 sq = 0; sq < 64; sq++) {
+        fprintf(out, "    { &magic_attack_table[%ld], &pext_attack_table[%ld], 0x%016llxULL, 0x%016llxULL, %d },\n",
+            (long)(table[sq].ptr - magic_attack_table), (long)(table[sq].pext_ptr - pext_attack_table),
+            (unsigned long long)table[sq].mask, (unsigned long long)table[sq].magic, table[sq].shift);
+    }
+    fprintf(out, "};\n\n");
+}
+
+i32 main(i32 argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <output.c>\n", argv[0]);
+        return 1;
+    }
+
+    generateMasks();
+    if (generateMagics()) return 1;
+    initZobrist();
+    init_pst();
+    init_lazy_margins();
+    init_masks();
+
+    FILE* out = fopen(argv[1], "w");
+    if (out == NULL) {
+        perror("Error opening output file");
+        return 1;
+    }
+
+    fprintf(out, "// Generated by tools/gentables.c with `make tables`, do not edit.\n\n");
+    fprintf(out, "#ifndef RUNTIME_TABLES\n\n");
+    fprintf(out, "#include \"bitboard/bitboard.h\"\n");
+    fprintf(out, "#include \"bitboard/bbutils.h\"\n");
+    fprintf(out, "#include \"bitboard/magic.h\"\n");
+    fprintf(out, "#include \"hash.h\"\n");
+    fprintf(out, "#include \"evaluator.h\"\n");
+    fprintf(out, "#include \"masks.h\"\n\n");
+
+    // Move masks
+    EMIT_U64(out, kingMoves, 64);
+    EMIT_U64(out, knightMoves, 64);
+    EMIT_U64(out, pawnMoves, 64, 8);
+    EMIT_U64(out, betweenMask, 64, 64);
+    EMIT_U64(out, rankMask, 64);
+    EMIT_U64(out, fileMask, 64);
+    EMIT_U64(out, NESWMask, 64);
+    EMIT_U64(out, NWSEMask, 64);
+
+    // Sliders
+    EMIT_U64(out, magic_attack_table, ATTACK_TABLE_SIZE);
+    EMIT_U64(out, pext_attack_table, ATTACK_TABLE_SIZE);
+    emitMagics(out, "mRookTbl", mRookTbl);
+    emitMagics(out, "mBishopTbl", mBishopTbl);
+
+    // Hashing
+    EMIT_U64(out, zobristTable, 64, 12);
+    EMIT_U64(out, zobristEnPassant, 8);
+    EMIT_U64(out, zobristCastle, 4);
+    fprintf(out, "const u64 zobristTurn = 0x%016llxULL;\n\n", (unsigned long long)zobristTurn);
+
+    // Evaluation
+    EMIT_SCORE(out, PST, 12, 64);
+    EMIT_SCORE(out, LazyGain, 6);
+    EMIT_SCORE(out, LazyLoss, 6);
+    EMIT_U64(out, PassedPawnMask, 2, 64);
+    EMIT_U64(out, KnightOutpostMask, 2);
+    EMIT_U64(out, KingAreaMask, 64);
+    EMIT_U64(out, BishopOutpostMask, 2);
+
+    fprintf(out, "#endif\n");
+    return fclose(out) ? 1 : 0;
+}
@@ -1,94 +1,511 @@
 #include "transposition.h"
 #include "types.h"
+#include "util.h"
+#include "hash.h"
 #include <stdatomic.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
 
 #if defined(__linux__)
     #include <sys/mman.h>
 #endif
 
-TTEntry* table = NULL;
-u64 key_mask = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    #define TT_HAS_MMAP
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+#define TT_AGE_WEIGHT       8 // How many plies of depth one search generation of age is worth when picking a victim
+#define TT_KEEP_DEPTH_MARGIN 3 // A same position store from this search only loses to an entry this much deeper
+#define TT_MAX_CLEAR_THREADS 64
+#define TT_MIN_CLEAR_SLICE   (1 << 15) // Buckets (2 MB) each clearing thread gets at least
+
+#define TT_FILE_MAGIC      0x0031485454444F47ULL // "GODTTH1" little endian
+#define TT_FILE_VERSION    2
+#define TT_KEY_SCHEME      1 // 16 bit key xored with the folded data, bucket picked by the high bits of hash * buckets
+#define TT_SHARED_WAIT_US  1000
+#define TT_SHARED_WAIT_TRIES 2000 // How long an attaching process waits for the creator to publish the header
+
+/*
+ * Header in front of a saved or shared table, it fills one cache line so the buckets behind it stay aligned when mapped
+ */
+typedef struct {
+    u64 magic;
+    u32 version;
+    u32 bucket_size;     // sizeof(TTBucket)
+    u32 bucket_entries;
+    u32 key_scheme;
+    u64 zobrist_check;   // Entries are only meaningful with the keys they were hashed with
+    u64 num_buckets;
+    u8  generation;      // A shared table bumps this for every search of any process
+    u8  reserved[23];
+} TTFileHeader;
+
+_Static_assert(sizeof(TTFileHeader) == sizeof(TTBucket), "TTFileHeader must fill exactly one cache line");
+
+TTBucket* tt_table = NULL;
+u64 tt_num_buckets = 0;
+static u8 tt_generation = 0; // Bumped for each search, entries from older generations are replaced first
+static void* tt_mapping = NULL; // Set when the table lives in a mapped hash file rather than the heap
+static u64 tt_mapping_size = 0;
+static TTFileHeader* tt_shared_header = NULL; // Set while the table lives in a shared memory segment
+
+// Probe counters of the calling thread, kept thread local so counting never shares a cache line
+static _Thread_local u64 tt_probes = 0;
+static _Thread_local u64 tt_hits   = 0;
+static _Thread_local u64 tt_stores = 0;
+
+static inline u16 fold_data(u64 data){
+    return (u16)(data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48));
+}
+
+static inline u32 pack_meta(u16 key, i32 static_eval){
+    if(static_eval <= INT16_MIN || static_eval > INT16_MAX) static_eval = TT_NO_EVAL; // Recomputed rather than clamped
+    return key | ((u32)(u16)static_eval << 16);
+}
+
+static inline i32 meta_static_eval(u32 meta){
+    return (i16)(meta >> 16);
+}
 
-i32 init_tt(i32 size_mb){
+static inline u8 entry_age(TTEntryData entry){
+    return (TT_GEN_CYCLE + tt_generation - (entry.fields.node_type >> TT_GEN_SHIFT)) % TT_GEN_CYCLE;
+}
+
+/*
+ * Allocates a table of size_mb, zeroed by num_threads threads so the first touch page faults are spread out
+ * The old table is only freed once the new one exists, on failure the old table stays in use
+ */
+i32 init_tt(u64 size_mb, u32 num_threads){
     const uint64_t MB = 1ull << 20;
-    if(table) tt_free();
+    size_mb = MIN(MAX(size_mb, 1), TT_MAX_MB);
 
-    // Calculate the table size that is less than or equal to the requested size in MB
-    u64 table_size = 1;
-    while ((table_size) * sizeof(TTEntry) <= size_mb * MB / 2) table_size = table_size << 1;
-    key_mask = table_size - 1;
+    // As many whole buckets as fit in the requested size
+    u64 new_buckets = MAX(1, size_mb * MB / sizeof(TTBucket));
+    u64 tt_size = new_buckets * sizeof(TTBucket);
+    TTBucket* new_table;
 
     // On linux systems we want to specify the page for better perfomance
 #if defined(__linux__) && !defined(__ANDROID__)
     if(size_mb >= 2){
-        table = aligned_alloc(2 * MB, table_size * sizeof(TTEntry));
-        madvise(table, table_size * sizeof(TTEntry), MADV_HUGEPAGE);
+        u64 alloc_size = (tt_size + 2 * MB - 1) & ~(2 * MB - 1); // aligned_alloc needs a multiple of the alignment
+        new_table = aligned_alloc(2 * MB, alloc_size);
+        if(new_table) madvise(new_table, alloc_size, MADV_HUGEPAGE);
     }
-    else table = (TTEntry*)calloc(table_size, sizeof(TTEntry));
+    else new_table = aligned_alloc(sizeof(TTBucket), tt_size);
 #else
-    table = (TTEntry*)calloc(table_size, sizeof(TTEntry));
+    new_table = aligned_alloc(sizeof(TTBucket), tt_size);
 #endif
-    
-    if(!table){
-        printf("info string Failure to allocate Transposition table");
+
+    if(!new_table){
+        printf("info string Failure to allocate Transposition table of %llu Mb\n", (unsigned long long)size_mb);
         return -1;
     }
-    
-    tt_clear();
 
-    long long tt_size = table_size * sizeof(TTEntry);
-    printf("info string TTEntry Size: %d, Transposition table size: %lld Mb\n", (int)sizeof(TTEntry), tt_size/MB);
+    tt_free();
+    tt_table = new_table;
+    tt_num_buckets = new_buckets;
+    tt_clear(num_threads);
+
+    printf("info string TTBucket Size: %d, Entries: %llu, Transposition table size: %llu Mb\n",
+           (int)sizeof(TTBucket), (unsigned long long)(tt_num_buckets * TT_BUCKET_ENTRIES), (unsigned long long)(tt_size / MB));
     return 0;
 }
 
 i32 tt_free(){
-    free(table);
+#ifdef TT_HAS_MMAP
+    if(tt_mapping) munmap(tt_mapping, tt_mapping_size);
+    else free(tt_table);
+#else
+    free(tt_table);
+#endif
+    tt_mapping = NULL;
+    tt_mapping_size = 0;
+    tt_shared_header = NULL;
+    tt_table = NULL;
+    tt_num_buckets = 0;
     return 0;
 }
 
-void tt_clear(){
-    memset(table, 0, (key_mask+1)*sizeof(TTEntry));
+typedef struct {
+    TTBucket* start;
+    u64 count;
+} ClearSlice;
+
+static void* clear_slice(void* arg){
+    ClearSlice* slice = (ClearSlice*)arg;
+    memset(slice->start, 0, slice->count * sizeof(TTBucket));
+    return NULL;
+}
+
+/*
+ * Zeroes the table split into one slice per thread, slices that fail to get a thread are cleared here
+ */
+void tt_clear(u32 num_threads){
+    num_threads = MIN(MAX(num_threads, 1), TT_MAX_CLEAR_THREADS);
+    if(tt_num_buckets < num_threads * TT_MIN_CLEAR_SLICE) num_threads = 1; // Not worth the thread start up
+
+    pthread_t threads[TT_MAX_CLEAR_THREADS];
+    ClearSlice slices[TT_MAX_CLEAR_THREADS];
+    u8 started[TT_MAX_CLEAR_THREADS] = {0};
+    u64 per_thread = tt_num_buckets / num_threads;
+
+    for(u32 i = 0; i < num_threads; i++){
+        slices[i].start = tt_table + i * per_thread;
+        slices[i].count = (i == num_threads - 1) ? tt_num_buckets - i * per_thread : per_thread;
+        if(i == 0) continue; // The calling thread takes the first slice
+        started[i] = pthread_create(&threads[i], NULL, clear_slice, &slices[i]) == 0;
+    }
+    clear_slice(&slices[0]);
+    for(u32 i = 1; i < num_threads; i++){
+        if(started[i]) pthread_join(threads[i], NULL);
+        else clear_slice(&slices[i]);
+    }
+    if(tt_shared_header) tt_generation = __atomic_load_n(&tt_shared_header->generation, __ATOMIC_RELAXED) % TT_GEN_CYCLE; // Age entries like the other processes
+    else                 tt_generation = 0;
 }
 
-TTEntryData get_tt_entry(u64 hash){
+/*
+ * Called once per go so entries written by earlier searches age out
+ */
+void tt_new_search(){
+    if(tt_shared_header) tt_generation = __atomic_add_fetch(&tt_shared_header->generation, 1, __ATOMIC_RELAXED) % TT_GEN_CYCLE;
+    else                 tt_generation = (tt_generation + 1) % TT_GEN_CYCLE;
+}
+
+/*
+ * Returns the entry for hash or empty data, static_eval (optional) gets the stored static eval or TT_NO_EVAL
+ */
+TTEntryData get_tt_entry(u64 hash, i32* static_eval){
+    TTBucket* bucket = tt_bucket(hash);
+    u16 key = (u16)hash;
     TTEntryData tt_data;
-    TTEntry tt_entry;
-    for(i32 i = 0; i < TT_ROTATION; i++){
-        u64 key = (hash + i) & key_mask;
-        tt_entry.data = atomic_load(&table[key].data);
-        tt_entry.hash = atomic_load(&table[key].hash);
-        if((tt_entry.data ^ tt_entry.hash) == hash){
-            tt_data.data = tt_entry.data;
+    tt_probes++;
+    for(i32 i = 0; i < TT_BUCKET_ENTRIES; i++){
+        tt_data.data = atomic_load_explicit(&bucket->data[i], memory_order_relaxed);
+        u32 meta = atomic_load_explicit(&bucket->meta[i], memory_order_relaxed);
+        if(tt_data.data && (u16)(meta ^ fold_data(tt_data.data)) == key){
+            tt_hits++;
+            if(static_eval) *static_eval = meta_static_eval(meta);
+            tt_data.fields.node_type &= TT_BOUND_MASK;
             return tt_data;
-        }   
+        }
     }
+    if(static_eval) *static_eval = TT_NO_EVAL;
     tt_data.data = 0;
     return tt_data;
 }
 
-void store_tt_entry(u64 hash, char depth, i32 eval, char node_type, Move move){
-    TTEntryData tt_data;
-    for(i32 i = 0; i < TT_ROTATION; i++){
-        u64 key = (hash + i) & key_mask;
-        tt_data.data = atomic_load(&table[key].data);
-        if(node_type != PV_NODE && (tt_data.fields.node_type == PV_NODE)){
+/*
+ * Stores into the slot holding the same position, otherwise over the shallowest and oldest entry in the bucket
+ * Pass TT_NO_EVAL as static_eval when the node was not evaluated, a same position entry keeps its eval then
+ */
+void store_tt_entry(u64 hash, char depth, i32 eval, i32 static_eval, char node_type, Move move){
+    TTBucket* bucket = tt_bucket(hash);
+    u16 key = (u16)hash;
+    i32 replace = 0;
+    i32 replace_score = INT_MAX;
+
+    for(i32 i = 0; i < TT_BUCKET_ENTRIES; i++){
+        TTEntryData entry;
+        entry.data = atomic_load_explicit(&bucket->data[i], memory_order_relaxed);
+        if(!entry.data){ // Empty, take it unless the position turns up later in the bucket
+            if(replace_score != INT_MIN){
+                replace = i;
+                replace_score = INT_MIN;
+            }
             continue;
         }
-        if(depth < tt_data.fields.depth){
-            continue;
+        u32 meta = atomic_load_explicit(&bucket->meta[i], memory_order_relaxed);
+        if((u16)(meta ^ fold_data(entry.data)) == key){
+            if(node_type != PV_NODE && entry_age(entry) == 0 && depth + TT_KEEP_DEPTH_MARGIN < entry.fields.depth) return;
+            if(move == NO_MOVE) move = entry.fields.move; // Keep the best move when storing a bound without one
+            if(static_eval == TT_NO_EVAL) static_eval = meta_static_eval(meta);
+            replace = i;
+            break;
+        }
+        i32 score = entry.fields.depth - TT_AGE_WEIGHT * entry_age(entry);
+        if(score < replace_score){
+            replace = i;
+            replace_score = score;
         }
-        tt_data.fields.eval = eval;
-        tt_data.fields.depth = depth;
-        tt_data.fields.move = move;
-        tt_data.fields.node_type = node_type;
-        hash ^= tt_data.data;
-        atomic_store(&table[key].data, tt_data.data);
-        atomic_store(&table[key].hash, hash);
-        return;
     }
+
+    TTEntryData tt_data;
+    tt_data.fields.eval = eval;
+    tt_data.fields.depth = depth;
+    tt_data.fields.move = move;
+    tt_data.fields.node_type = node_type | (tt_generation << TT_GEN_SHIFT);
+    atomic_store_explicit(&bucket->data[replace], tt_data.data, memory_order_relaxed);
+    atomic_store_explicit(&bucket->meta[replace], pack_meta(key ^ fold_data(tt_data.data), static_eval), memory_order_relaxed);
+    tt_stores++;
+}
+
+/*
+ * Probe counters of the calling thread along with the table geometry
+ */
+TTStats tt_stats(){
+    TTStats stats;
+    stats.probes     = tt_probes;
+    stats.hits       = tt_hits;
+    stats.stores     = tt_stores;
+    stats.entries    = tt_num_buckets * TT_BUCKET_ENTRIES;
+    stats.size_bytes = tt_num_buckets * sizeof(TTBucket);
+    return stats;
+}
+
+void tt_reset_stats(){
+    tt_probes = tt_hits = tt_stores = 0;
+}
+
+
+/*
+ * Fingerprint of the zobrist keys, a file saved by a build with different keys would only give false hits
+ */
+static u64 zobrist_check(void){
+    u64 check = zobristTurn;
+    for(i32 sq = 0; sq < 64; sq++){
+        for(i32 piece = 0; piece < 12; piece++) check = ((check << 7) | (check >> 57)) ^ zobristTable[sq][piece];
+    }
+    for(i32 i = 0; i < 8; i++) check = ((check << 7) | (check >> 57)) ^ zobristEnPassant[i];
+    for(i32 i = 0; i < 4; i++) check = ((check << 7) | (check >> 57)) ^ zobristCastle[i];
+    return check;
 }
 
-    
+static i32 check_tt_header(const TTFileHeader* header, u64 file_size, const char* path){
+    const char* problem = NULL;
+    if(header->magic != TT_FILE_MAGIC)                        problem = "is not a hash file";
+    else if(header->version != TT_FILE_VERSION)               problem = "has an unsupported version";
+    else if(header->bucket_size != sizeof(TTBucket)
+         || header->bucket_entries != TT_BUCKET_ENTRIES
+         || header->key_scheme != TT_KEY_SCHEME)              problem = "uses a different entry layout";
+    else if(header->zobrist_check != zobrist_check())         problem = "was hashed with different zobrist keys";
+    else if(header->num_buckets == 0
+         || header->num_buckets > TT_MAX_MB * (1ull << 20) / sizeof(TTBucket)
+         || file_size != sizeof(TTFileHeader) + header->num_buckets * sizeof(TTBucket)) problem = "is truncated or corrupt";
+
+    if(problem){
+        printf("info string Hash file %s %s\n", path, problem);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Writes the table to path behind a versioned header, through a temporary file so a failed save never replaces a good one
+ * No search may be running
+ */
+i32 tt_save(const char* path){
+    char tmp_path[4096];
+    if(!tt_table || snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (i32)sizeof(tmp_path)) return -1;
+
+    FILE* file = fopen(tmp_path, "wb");
+    if(!file){
+        printf("info string Failed to open hash file %s\n", tmp_path);
+        return -1;
+    }
+    TTFileHeader header = {0};
+    header.magic          = TT_FILE_MAGIC;
+    header.version        = TT_FILE_VERSION;
+    header.bucket_size    = sizeof(TTBucket);
+    header.bucket_entries = TT_BUCKET_ENTRIES;
+    header.key_scheme     = TT_KEY_SCHEME;
+    header.zobrist_check  = zobrist_check();
+    header.num_buckets    = tt_num_buckets;
+    header.generation     = tt_generation;
+
+    u8 ok = fwrite(&header, sizeof(header), 1, file) == 1
+         && fwrite(tt_table, sizeof(TTBucket), tt_num_buckets, file) == tt_num_buckets;
+    ok = (fclose(file) == 0) && ok;
+    if(!ok || rename(tmp_path, path)){
+        remove(tmp_path);
+        printf("info string Failed to write hash file %s\n", path);
+        return -1;
+    }
+    printf("info string Saved %llu Mb of hash to %s\n",
+           (unsigned long long)(tt_num_buckets * sizeof(TTBucket) >> 20), path);
+    return 0;
+}
+
+/*
+ * Replaces the table with the one saved in path, the table size becomes the saved size
+ * The file is mapped copy on write so pages load as the search touches them and the file itself is never modified
+ * No search may be running, on failure the old table stays in use
+ */
+i32 tt_load(const char* path){
+    TTFileHeader header;
+#ifdef TT_HAS_MMAP
+    i32 fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st)){
+        if(fd >= 0) close(fd);
+        printf("info string Failed to open hash file %s\n", path);
+        return -1;
+    }
+    u64 file_size = (u64)st.st_size;
+    if(file_size < sizeof(TTFileHeader)){
+        close(fd);
+        return check_tt_header(&(TTFileHeader){0}, file_size, path);
+    }
+    void* mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps its own reference to the file
+    if(mapping == MAP_FAILED){
+        printf("info string Failed to map hash file %s\n", path);
+        return -1;
+    }
+    memcpy(&header, mapping, sizeof(header));
+    if(check_tt_header(&header, file_size, path)){
+        munmap(mapping, file_size);
+        return -1;
+    }
+    madvise(mapping, file_size, MADV_WILLNEED); // Start reading ahead while the next search gets going
+
+    tt_free();
+    tt_mapping = mapping;
+    tt_mapping_size = file_size;
+    tt_table = (TTBucket*)((u8*)mapping + sizeof(TTFileHeader));
+#else
+    FILE* file = fopen(path, "rb");
+    if(!file){
+        printf("info string Failed to open hash file %s\n", path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    u64 file_size = (u64)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if(fread(&header, sizeof(header), 1, file) != 1) header = (TTFileHeader){0};
+    if(check_tt_header(&header, file_size, path)){
+        fclose(file);
+        return -1;
+    }
+    TTBucket* new_table = aligned_alloc(sizeof(TTBucket), header.num_buckets * sizeof(TTBucket));
+    if(!new_table || fread(new_table, sizeof(TTBucket), header.num_buckets, file) != header.num_buckets){
+        free(new_table);
+        fclose(file);
+        printf("info string Failed to read hash file %s\n", path);
+        return -1;
+    }
+    fclose(file);
+    tt_free();
+    tt_table = new_table;
+#endif
+    tt_num_buckets = header.num_buckets;
+    tt_generation = header.generation % TT_GEN_CYCLE;
+    printf("info string Loaded %llu Mb of hash from %s\n",
+           (unsigned long long)(tt_num_buckets * sizeof(TTBucket) >> 20), path);
+    return 0;
+}
+
+/*
+ * Backs the table with the named POSIX shared memory segment so engine processes on one host share their entries
+ * The first process creates the segment with size_mb, later ones attach at whatever size it was created with
+ * The size is fixed once the segment exists, a size_mb that differs from it is ignored with a warning
+ * Entries keep the lockless key ^ data verification, a torn write from another process only costs a miss
+ */
+i32 init_tt_shared(const char* name, u64 size_mb){
+#ifdef TT_HAS_MMAP
+    char shm_name[256];
+    if(name == NULL || name[0] == '\0'
+    || snprintf(shm_name, sizeof(shm_name), "%s%s", name[0] == '/' ? "" : "/", name) >= (i32)sizeof(shm_name)) return -1;
+
+    size_mb = MIN(MAX(size_mb, 1), TT_MAX_MB);
+    u64 want_buckets = MAX(1, size_mb * (1ull << 20) / sizeof(TTBucket));
+    u64 map_size = sizeof(TTFileHeader) + want_buckets * sizeof(TTBucket);
+    u8 created = TRUE;
+    i32 fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd < 0 && errno == EEXIST){
+        created = FALSE;
+        fd = shm_open(shm_name, O_RDWR, 0600);
+    }
+    if(fd < 0){
+        printf("info string Failed to open shared hash %s\n", shm_name);
+        return -1;
+    }
+
+    if(created){
+        if(ftruncate(fd, map_size)){ // Zero filled, so the new table is already clear
+            close(fd);
+            shm_unlink(shm_name);
+            printf("info string Failed to size shared hash %s\n", shm_name);
+            return -1;
+        }
+    }
+    else {
+        struct stat st;
+        for(i32 tries = 0; !fstat(fd, &st) && st.st_size == 0 && tries < TT_SHARED_WAIT_TRIES; tries++) usleep(TT_SHARED_WAIT_US);
+        map_size = (u64)st.st_size;
+    }
+
+    void* mapping = map_size ? mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(mapping == MAP_FAILED){
+        if(created) shm_unlink(shm_name);
+        printf("info string Failed to map shared hash %s\n", shm_name);
+        return -1;
+    }
+
+    TTFileHeader* header = (TTFileHeader*)mapping;
+    if(created){
+        header->version        = TT_FILE_VERSION;
+        header->bucket_size    = sizeof(TTBucket);
+        header->bucket_entries = TT_BUCKET_ENTRIES;
+        header->key_scheme     = TT_KEY_SCHEME;
+        header->zobrist_check  = zobrist_check();
+        header->num_buckets    = (map_size - sizeof(TTFileHeader)) / sizeof(TTBucket);
+        __atomic_store_n(&header->magic, TT_FILE_MAGIC, __ATOMIC_RELEASE); // Attaching processes wait on the magic
+    }
+    else {
+        for(i32 tries = 0; __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != TT_FILE_MAGIC && tries < TT_SHARED_WAIT_TRIES; tries++) usleep(TT_SHARED_WAIT_US);
+        if(check_tt_header(header, map_size, shm_name)){
+            munmap(mapping, map_size);
+            return -1;
+        }
+    }
+
+    tt_free();
+    tt_mapping = mapping;
+    tt_mapping_size = map_size;
+    tt_shared_header = header;
+    tt_table = (TTBucket*)((u8*)mapping + sizeof(TTFileHeader));
+    tt_num_buckets = header->num_buckets;
+    tt_generation = __atomic_load_n(&header->generation, __ATOMIC_RELAXED) % TT_GEN_CYCLE;
+    printf("info string %s shared hash %s, Transposition table size: %llu Mb\n", created ? "Created" : "Attached to", shm_name,
+           (unsigned long long)(tt_num_buckets * sizeof(TTBucket) >> 20));
+    if(!created && tt_num_buckets != want_buckets){
+        printf("info string Hash %llu Mb ignored, shared hash %s keeps the size it was created with until it is unlinked\n",
+               (unsigned long long)size_mb, shm_name);
+    }
+    return 0;
+#else
+    (void)name;
+    (void)size_mb;
+    printf("info string Shared hash is not supported on this platform\n");
+    return -1;
+#endif
+}
+
+/*
+ * Removes the segment name, processes still attached keep their mapping until they detach
+ */
+i32 tt_unlink_shared(const char* name){
+#ifdef TT_HAS_MMAP
+    char shm_name[256];
+    if(name == NULL || name[0] == '\0'
+    || snprintf(shm_name, sizeof(shm_name), "%s%s", name[0] == '/' ? "" : "/", name) >= (i32)sizeof(shm_name)) return -1;
+    return shm_unlink(shm_name);
+#else
+    (void)name;
+    return -1;
+#endif
+}
+
+u8 tt_is_shared(){
+    return tt_shared_header != NULL;
+}
@@ -1,6 +1,7 @@
 #ifndef TRANSPOSITION_H
 #define TRANSPOSITION_H
 #include "types.h"
+#include "util.h"
 #include <stdatomic.h>
 #include <stdalign.h>
 #include <stdint.h>
@@ -10,23 +11,35 @@ enum {
     PV_NODE  = 1,
     CUT_NODE = 2,
     ALL_NODE = 3,
-
-    TT_ROTATION = 3,
 };
 
+#define TT_BUCKET_ENTRIES 5    // Entries sharing one cache line
+#define TT_BOUND_MASK     0x3  // node_type lives in the low bits of genbound
+#define TT_GEN_SHIFT      2    // The search generation in the high 6 bits
+#define TT_GEN_CYCLE      64
+#define TT_NO_EVAL        INT16_MIN // Static eval slot that was never filled, or held an eval too large for 16 bits
+
+#define TT_DEFAULT_MB     16
+#define TT_MAX_MB         131072 // 128 GB
+
 #pragma pack(1)
 typedef struct {
     u8 depth;
     Move move;
-    u8 node_type;
+    u8 node_type; // Stored as genbound, get_tt_entry hands back only the node type
     i32 eval;
 } TTEntryFields;
 #pragma pack()
 
+/*
+ * One cache line of entries, the 16 bit key of each is xored with a fold of its data
+ * so a torn read between two threads fails verification instead of returning another position's data
+ * The static eval shares the atomic word of the key, so it is verified along with it
+ */
 typedef struct {
-    alignas(8) _Atomic u64 data;
-    alignas(8) _Atomic u64 hash;
-} TTEntry;
+    alignas(64) _Atomic u64 data[TT_BUCKET_ENTRIES];
+    _Atomic u32 meta[TT_BUCKET_ENTRIES]; // Key in the low 16 bits, static eval in the high 16
+} TTBucket;
 
 typedef union {
     u64 data;
@@ -35,11 +48,46 @@ typedef union {
 
 _Static_assert(sizeof(TTEntryData)   == 8, "Size of TTEntryData is not 64 bits");
 _Static_assert(sizeof(TTEntryFields) == 8, "Size of TTEntryFields is not 64 bits");
+_Static_assert(sizeof(TTBucket)     == 64, "TTBucket does not fill exactly one cache line");
+
+typedef struct {
+    u64 probes;
+    u64 hits;
+    u64 stores;
+    u64 entries;      // Slots in the table
+    u64 size_bytes;
+} TTStats;
+
+extern TTBucket* tt_table;
+extern u64 tt_num_buckets;
+
+/*
+ * Maps the hash onto a bucket with a multiply so the table size need not be a power of two
+ * The high bits pick the bucket and the low 16 bits are the stored key, so the two stay independent
+ */
+static inline TTBucket* tt_bucket(u64 hash){
+    return &tt_table[(u64)(((unsigned __int128)hash * tt_num_buckets) >> 64)];
+}
+
+/*
+ * Starts loading the bucket of a position we are about to probe, call it as soon as the hash is known
+ */
+static inline void prefetch_tt(u64 hash){
+    PREFETCH(tt_bucket(hash));
+}
 
-i32 init_tt(i32 size_mb);
+i32 init_tt(u64 size_mb, u32 num_threads);
 i32 tt_free();
-void tt_clear();
-void store_tt_entry(u64 hash, char depth, i32 eval, char node_type, Move move);
+void tt_clear(u32 num_threads);
+void tt_new_search();
+i32 tt_save(const char* path);
+i32 tt_load(const char* path);
+i32 init_tt_shared(const char* name, u64 size_mb);
+i32 tt_unlink_shared(const char* name);
+u8 tt_is_shared();
+void store_tt_entry(u64 hash, char depth, i32 eval, i32 static_eval, char node_type, Move move);
 
-TTEntryData get_tt_entry(u64 hash);
-#endif
\ No newline at end of file
+TTEntryData get_tt_entry(u64 hash, i32* static_eval);
+TTStats tt_stats();
+void tt_reset_stats();
+#endif
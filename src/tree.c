@@ -3,6 +3,7 @@
 #include <string.h>
 #include <pthread.h>
 #include <time.h>
+#include <stdatomic.h>
 
 #include "tree.h"
 
@@ -15,6 +16,7 @@
 #include "transposition.h"
 #include "globals.h"
 #include "tables.h"
+#include "hash.h"
 #include "bitboard/bbutils.h"
 
 
@@ -27,6 +29,9 @@
 
 #define LMR_DEPTH 3       // LMR not performed if depth < LMR_DEPTH
 
+#define STOP_POLL_NODES 1024 // Nodes between checks of the stop flag, node limit and deadline
+#define SEARCH_STOPPED  0    // Returned while a stopped search unwinds, callers check stats->stopped instead of the score
+
 #define ASP_EDGE         250  // Buffer size of aspiration window
 #define HELPER_ASP_EDGE  500  // Buffer size of aspiration window in helper search
 
@@ -36,8 +41,6 @@
 #define NULL_PRUNE_R 3  // How much Null prunin' takes off
 #define NMR_MARGIN 2000 // The higher this is, the more likely a null move search is to be taken
 
-#define HELPER_MOVE_DISORDER 3 // Increasing this changes how out of order helper searches look at moves
-#define HELPER_THREAD_DISORDER 3 // How different each helper thread searches from one another
 
 /* Delta Pruning Rules */
 const int DeltaValue      =  750;
@@ -58,6 +61,26 @@ void startStats(SearchStats* stats){
    stats->elap_time = 0;
 }
 
+/*
+ * Counts a node for this iteration and for the thread's running total that info nps is summed from
+ */
+static inline void countNode(SearchStats* stats){
+   stats->node_count++;
+   if(stats->thread_nodes){ // Only this thread writes its counter, so a relaxed load and store is enough
+      atomic_store_explicit(stats->thread_nodes, atomic_load_explicit(stats->thread_nodes, memory_order_relaxed) + 1, memory_order_relaxed);
+   }
+}
+
+/*
+ * Checks for a stop every STOP_POLL_NODES nodes, so the shared flag and the clock stay off the per node path
+ */
+static inline u8 searchStopped(SearchStats* stats){
+   if(--stats->poll_countdown > 0) return stats->stopped;
+   stats->poll_countdown = STOP_POLL_NODES;
+   if(!stats->stopped && poll_search_stop()) stats->stopped = TRUE;
+   return stats->stopped;
+}
+
 void stopStats(SearchStats* stats){
    clock_gettime(CLOCK_MONOTONIC, &stats->end_time);
    stats->elap_time = (stats->end_time.tv_sec - stats->start_time.tv_sec) +
@@ -192,63 +215,6 @@ static double calculateEBF(){
 }
 #endif
 
-#define TT_MOVE_BONUS       3000000 // Bonus for move being in the TT
-#define CAPTURE_MOVE_BONUS  2000000 // Bonus for move being a capture
-#define KILLER_MOVE_BONUS   1000000 // Bonus for move being killer move
-
-static inline u32 select_sort(u32 i, u32 evalIdx, Position* pos, Move *moveList, i32 *moveVals, u32 size, KillerMoves* km, Move ttMove, u32 ply) {
-   u32 maxIdx = i;
-
-   if(moveList[i] == ttMove){
-      moveVals[i] = TT_MOVE_BONUS;
-      return evalIdx; // Return if the next move is the TTMove
-   }
-
-   if(i <= evalIdx){
-      moveVals[i] = eval_move(moveList[i], pos);
-      if(GET_FLAGS(moveList[i]) > DOUBLE_PAWN_PUSH){
-         moveVals[i] += CAPTURE_MOVE_BONUS;
-      } else if(isKillerMove(km, moveList[i], ply)){
-         moveVals[i] += KILLER_MOVE_BONUS;
-      }
-      evalIdx = i+1;
-   }
-
-   for (u32 j = i + 1; j < size; j++) {
-      if(moveList[j] == ttMove){ // If the move is in the TT sort immediatly
-         maxIdx = j;
-         moveVals[j] = TT_MOVE_BONUS;
-         break;
-      }
-
-      if(j <= evalIdx){ // If the move hasn't been evaluated yet calculate score
-         moveVals[j] = eval_move(moveList[j], pos);
-         if(GET_FLAGS(moveList[j]) > DOUBLE_PAWN_PUSH){
-            moveVals[j] += CAPTURE_MOVE_BONUS;
-         } else if(isKillerMove(km, moveList[j], ply)){
-            moveVals[j] += KILLER_MOVE_BONUS;
-         }
-         evalIdx = j+1;
-      }
-
-      if (moveVals[j] > moveVals[maxIdx]) {
-         maxIdx = j;
-      }
-   }
-
-   if (maxIdx != i) { // Swap the moves
-      i32 tempVal = moveVals[i];
-      moveVals[i] = moveVals[maxIdx];
-      moveVals[maxIdx] = tempVal;
-
-      Move tempMove = moveList[i];
-      moveList[i] = moveList[maxIdx];
-      moveList[maxIdx] = tempMove;
-   }
-
-   return evalIdx;
-}
-
 /*
  * Simple select sort for q search
  */
@@ -272,30 +238,21 @@ static inline void q_select_sort(i32 i, Move *moveList, i32 *moveVals, i32 size)
    }
 }
 
-/*
- * Select sort for the helper search with slighly different ordering
- */
-static inline u32 helper_select_sort(u32 i, u32 evalIdx, Position* pos, Move *moveList, i32 *moveVals, u32 size, KillerMoves* km, Move ttMove, u32 ply, u32 thread_num) {
-   i32 thread_dif = (thread_num % 2) ? -1 : 1;
-   moveVals[i] += ((i32)i * HELPER_MOVE_DISORDER) + (thread_dif * (i32)thread_num * HELPER_THREAD_DISORDER);
-   select_sort(i, evalIdx, pos, moveList, moveVals, size, km, ttMove, ply);
-   return evalIdx;
-}
-
 /*
  * On a TT hit in the mainline fills the pv array with the PV for printing
  */
 static inline void pvFill(Position pos, Move* pv_array, u8 depth){
    u8 ply = 0;
-   TTEntryData ttEntry = get_tt_entry(pos.hash);
+   TTEntryData ttEntry = get_tt_entry(pos.hash, NULL);
    while(ttEntry.data && ttEntry.fields.depth > 0 && ply < depth){
       pv_array[ply] = ttEntry.fields.move;
       #ifdef DEBUG
       if(ttEntry.fields.move == NO_MOVE) printf("NO MOVE FOUND IN PV");
       #endif
-      makeMove(&pos, ttEntry.fields.move);
+      Undo undo;
+      makeMove(&pos, ttEntry.fields.move, &undo);
       ply++;
-      ttEntry = get_tt_entry(pos.hash);
+      ttEntry = get_tt_entry(pos.hash, NULL);
    }
 }
 
@@ -309,7 +266,7 @@ void search_opening(u32 depth){
    #endif
    run_get_best_move = TRUE;
    Position pos = fen_to_position(START_FEN);
-   SearchStats stats;
+   SearchStats stats = {0};
    Move pv_array[MAX_DEPTH] = {0};
    KillerMoves km = {0};
 
@@ -322,13 +279,13 @@ void search_opening(u32 depth){
 
    eval_movelist(&pos, moveList, moveVals, size);
    
-   Position prevPos = pos;
+   Undo undo;
    for (i32 i = 0; i < size; i++)  {
       q_select_sort(i, moveList, moveVals, size); 
       if(moveVals[i] <= 0) break;
-      makeMove(&pos, moveList[i]);
+      makeMove(&pos, moveList[i], &undo);
       search_tree(pos, depth, pv_array, &km, 0, &stats, NULL);
-      pos = prevPos;
+      unmakeMove(&pos, moveList[i], &undo);
    }
 
    remove_hash_stack(&pos.hashStack);
@@ -370,7 +327,7 @@ i32 search_tree(Position pos, u32 depth, Move *pv_array, KillerMoves* km, i32 ev
       eval = pv_search(&searchPos, q-asp_lower, q+asp_upper, depth, 0, pv_array, km, stats, time_preference);
       searchPos = pos;
       while(eval <= q-asp_lower || eval >= q+asp_upper || pv_array[0] == NO_MOVE){
-         if(abs(eval) == CHECKMATE_VALUE) break;
+         if(stats->stopped || abs(eval) == CHECKMATE_VALUE) break;
          if(eval <= q-asp_lower){
             asp_upper = ASP_EDGE;
             asp_lower = (asp_lower + ASP_EDGE) * 2;
@@ -397,6 +354,10 @@ i32 search_tree(Position pos, u32 depth, Move *pv_array, KillerMoves* km, i32 ev
          searchPos = pos;
       }
    }
+   if(stats->stopped){ // The iteration was cut short, its PV and score are incomplete
+      stopStats(stats);
+      return SEARCH_STOPPED;
+   }
    pvFill(searchPos, pv_array, depth);
 
    #ifdef DEBUG
@@ -422,7 +383,7 @@ i32 helper_search_tree(Position pos, u32 depth, Move *pv_array, KillerMoves* km,
    eval = helper_pv_search(&searchPos, q-asp_lower, q+asp_upper, depth, 0, pv_array, km, stats, thread_num);
    searchPos = pos;
    while(eval <= q-asp_lower || eval >= q+asp_upper || pv_array[0] == NO_MOVE){
-      if(abs(eval) == CHECKMATE_VALUE) break;
+      if(stats->stopped || abs(eval) == CHECKMATE_VALUE) break;
       if(eval <= q-asp_lower){
          asp_upper = HELPER_ASP_EDGE;
          asp_lower = (asp_lower + HELPER_ASP_EDGE) * 2;
@@ -449,10 +410,11 @@ i32 helper_search_tree(Position pos, u32 depth, Move *pv_array, KillerMoves* km,
 
 // Null Move Search
 static inline i32 pruneNullMoves(Position* pos, i32 beta, i32 depth, i32 ply, KillerMoves* km, SearchStats* stats){
-   Position prevPos = *pos;
-   makeNullMove(pos);
+   Undo undo;
+   makeNullMove(pos, &undo);
+   prefetch_tt(pos->hash);
    i32 score = -zw_search(pos, 1-beta, depth - NULL_PRUNE_R - 1, ply + 1, km, stats, TRUE);
-   *pos = prevPos;
+   unmakeNullMove(pos, &undo);
    return score;
 }
 
@@ -474,9 +436,9 @@ static inline u8 getLMRDepth(u8 curDepth, u8 moveIdx, u8 moveCount, Move move, i
 */
 i32 pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move* pv_array, KillerMoves* km, SearchStats* stats, TimePreference* time_preference) {
    //printf("Depth = %d, Ply = %d, Depth+ply = %d\n", depth, ply, depth+ply);
-   if(!run_get_best_move) exit_search(pos);
+   if(searchStopped(stats)) return SEARCH_STOPPED;
 
-   stats->node_count++;
+   countNode(stats);
    #ifdef DEBUG
    debug[PVS][NODE_COUNT]++;
    #endif
@@ -484,36 +446,20 @@ i32 pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move* pv_ar
 
    if(ply != 0 && (pos->halfmove_clock >= 100 || isInsufficient(pos) || isRepetition(pos))) return 0;
 
-   Move moveList[MAX_MOVES];
-   i32 moveVals[MAX_MOVES];
-   i32 size = generateLegalMoves(pos, moveList);
-   for(i32 i = 0; i < size; i++){
-      moveVals[i] = 0;
-   }
-
-   //Store the list of moves and their evaluations at the start
-   #ifdef DEBUG
-   //Store the values at the starting time
-   if(ply == 0){
-      debug_size[0] = size;
-      memcpy(debug_moveList[0], moveList, size*sizeof(i32));
-      memcpy(debug_moveVals[0], moveVals, size*sizeof(i32));
-   }
-   #endif
-
-
-   //Handle Draw, Mate, or single move
-   if(size == 0){
-      if(time_preference && ply == 0) *time_preference = HALT_TIME;
-      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
-      else return 0;
-   }
-   else if(size == 1 && time_preference && ply == 0){
-      *time_preference = HALT_TIME;
+   //Stop thinking at the root when there is no choice to make
+   if(ply == 0 && time_preference){
+      Move rootMoves[MAX_MOVES];
+      i32 rootSize = generateLegalMoves(pos, rootMoves);
+      if(rootSize <= 1) *time_preference = HALT_TIME;
+      #ifdef DEBUG
+      debug_size[0] = rootSize;
+      memcpy(debug_moveList[0], rootMoves, rootSize*sizeof(Move));
+      memset(debug_moveVals[0], 0, rootSize*sizeof(i32));
+      #endif
    }
 
    //Test the TT table
-   TTEntryData ttEntry = get_tt_entry(pos->hash);
+   TTEntryData ttEntry = get_tt_entry(pos->hash, NULL);
    Move ttMove = NO_MOVE;
    if (ttEntry.data) {
       #ifdef DEBUG
@@ -552,9 +498,7 @@ i32 pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move* pv_ar
 
    if( depth <= 0 ) {
       i32 q_eval = q_search(pos, alpha, beta, ply, 0, stats);
-      if     (q_eval < alpha) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE);
-      else if(q_eval >= beta) store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE);
-      else                    store_tt_entry(pos->hash, 0, q_eval,  PV_NODE, NO_MOVE);
+      if(stats->stopped) return SEARCH_STOPPED;
       return q_eval;
    }
 
@@ -562,42 +506,37 @@ i32 pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move* pv_ar
    char prunable = !(pos->flags & IN_CHECK);
    if(abs(beta-1) >= CHECKMATE_VALUE/2) prunable = FALSE;
    if(pos->stage == END_GAME) prunable = FALSE;
-
-   //Store the list of moves and their evaluations at the start
-   #ifdef DEBUG
-   //Store the values at the starting time
-   if(ply == 0){
-      debug_size[1] = size;
-      memcpy(debug_moveList[1], moveList, size*sizeof(i32));
-      memcpy(debug_moveVals[1], moveVals, size*sizeof(i32));
-   }
-   #endif
-
-   #ifdef DEBUG
-   if(size > 0) debug[PVS][NODE_LOOP_CHILDREN]++;
-   #endif
+   i32 node_material = eval_material(pos); // Futility margins are measured from the material before the move
 
    Move bestMove = NO_MOVE;
    i32 bestScore = MIN_EVAL;
    u8 exact = FALSE;
-   u32 evalIdx = 0; // Used for select sort
-   Position prevPos = *pos;
-   for (i32 i = 0; i < size; i++)  {
+   MovePicker mp;
+   init_move_picker(&mp, ttMove, km, ply, 0);
+   Move move;
+   i32 moveVal;
+   i32 i;
+   Undo undo;
+   #ifdef DEBUG
+   u64 prev_hash = pos->hash;
+   #endif
+   for (i = 0; (move = next_move(&mp, pos, &moveVal)) != NO_MOVE; i++)  {
       #ifdef DEBUG
-      assert(prevPos.hash == pos->hash);
+      assert(prev_hash == pos->hash);
+      if(i == 0) debug[PVS][NODE_LOOP_CHILDREN]++;
       #endif
-      evalIdx = select_sort(i, evalIdx, pos, moveList, moveVals, size, km, ttMove, ply);
-      makeMove(pos, moveList[i]);
+      makeMove(pos, move, &undo);
+      prefetch_tt(pos->hash);
       // Update Prunability PVS
       u8 prunable_move = prunable;
-      if(i <= PV_PRUNE_MOVE_IDX || pos->flags & IN_CHECK || (GET_FLAGS(moveList[i]) > DOUBLE_PAWN_PUSH) || pos->stage == END_GAME ) prunable_move = FALSE;
+      if(i <= PV_PRUNE_MOVE_IDX || pos->flags & IN_CHECK || (GET_FLAGS(move) > DOUBLE_PAWN_PUSH) || pos->stage == END_GAME ) prunable_move = FALSE;
 
       if( prunable_move && depth == 1 && abs(alpha) < (CHECKMATE_VALUE/2) && abs(beta) < (CHECKMATE_VALUE/2)){ // Futility Pruning
-         if(prevPos.material_eval + moveVals[i] < alpha - PV_FUTIL_MARGIN){ 
+         if(node_material + moveVal < alpha - PV_FUTIL_MARGIN){ 
             #ifdef DEBUG
             debug[PVS][NODE_PRUNED_FUTIL]++;
             #endif
-            *pos = prevPos; //Unmake Move
+            unmakeMove(pos, move, &undo);
             continue;
          }
       }
@@ -613,20 +552,21 @@ i32 pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move* pv_ar
          }
       }
 
-      *pos = prevPos; //Unmake Move
+      unmakeMove(pos, move, &undo);
+      if(stats->stopped) return SEARCH_STOPPED;
 
       if( score >= beta ) { //Beta cutoff
-         store_tt_entry(pos->hash, depth, score, CUT_NODE, moveList[i]);
-         storeKillerMove(km, ply, moveList[i]);
-         //storeHistoryMove(pos->flags, moveList[i], depth);
+         store_tt_entry(pos->hash, depth, score, TT_NO_EVAL, CUT_NODE, move);
+         storeKillerMove(km, ply, move);
+         //storeHistoryMove(pos->flags, move, depth);
       
          #ifdef DEBUG
          //printf("Returning beta cutoff: %d >= %d\n", score, beta);
          debug[PVS][NODE_BETA_CUT]++;
          if(ply == 0){
-            debug_size[3] = size;
-            memcpy(debug_moveList[3], moveList, size*sizeof(i32));
-            memcpy(debug_moveVals[3], moveVals, size*sizeof(i32));
+            debug_size[3] = mp.size;
+            memcpy(debug_moveList[3], mp.moveList, mp.size*sizeof(Move));
+            memcpy(debug_moveVals[3], mp.moveVals, mp.size*sizeof(i32));
          }
          #endif
          return beta;
@@ -634,50 +574,47 @@ i32 pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move* pv_ar
       if( score > alpha ) {  //Improved alpha
          alpha = score;
          exact = TRUE;
-         pv_array[ply] = moveList[i];
+         pv_array[ply] = move;
       }
       if( score > bestScore ){ //Improved best move
-         bestMove = moveList[i];
+         bestMove = move;
          bestScore = score;
       }
    }
+
+   //Handle Draw or Mate
+   if(i == 0){
+      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
+      else return 0;
+   }
+
    if (exact) {
       // PV Node (exact value)
-      store_tt_entry(pos->hash, depth, alpha, PV_NODE, pv_array[ply]);
+      store_tt_entry(pos->hash, depth, alpha, TT_NO_EVAL, PV_NODE, pv_array[ply]);
    } else {
       // ALL Node (upper bound)
-      store_tt_entry(pos->hash, depth, bestScore, ALL_NODE, bestMove);
+      store_tt_entry(pos->hash, depth, bestScore, TT_NO_EVAL, ALL_NODE, bestMove);
    }
    #ifdef DEBUG
    debug[PVS][NODE_ALPHA_RET]++;
 
    if(ply == 0){
-      debug_size[4] = size;
-      memcpy(debug_moveList[4], moveList, size*sizeof(i32));
-      memcpy(debug_moveVals[4], moveVals, size*sizeof(i32));
+      debug_size[4] = mp.size;
+      memcpy(debug_moveList[4], mp.moveList, mp.size*sizeof(Move));
+      memcpy(debug_moveVals[4], mp.moveVals, mp.size*sizeof(i32));
    }
    #endif
    return alpha;
 }
 
 i32 helper_pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move* pv_array, KillerMoves* km, SearchStats* stats, u32 thread_num) {
-   if(!run_get_best_move) exit_search(pos);
+   if(searchStopped(stats)) return SEARCH_STOPPED;
+   countNode(stats);
    pv_array[ply] = NO_MOVE;
    if(ply != 0 && (pos->halfmove_clock >= 100 || isInsufficient(pos) || isRepetition(pos))) return 0;
 
-   Move moveList[MAX_MOVES];
-   i32 moveVals[MAX_MOVES] = {0};
-
-   i32 size = generateLegalMoves(pos, moveList);
-
-   //Handle Draw or Mate
-   if(size == 0){
-      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
-      else return 0;
-   }
-
    //Test the TT table
-   TTEntryData ttEntry = get_tt_entry(pos->hash);
+   TTEntryData ttEntry = get_tt_entry(pos->hash, NULL);
    Move ttMove = NO_MOVE;
    if (ttEntry.data) {
       #ifdef DEBUG
@@ -706,23 +643,28 @@ i32 helper_pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move
    }
    if( depth <= 0 ) {
       i32 q_eval = q_search(pos, alpha, beta, ply, 0, stats);
-      if     (q_eval < alpha) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE);
-      else if(q_eval >= beta) store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE);
-      else                    store_tt_entry(pos->hash, 0, q_eval,  PV_NODE, NO_MOVE);
+      if(stats->stopped) return SEARCH_STOPPED;
       return q_eval;
    }
    
    Move bestMove = NO_MOVE;
    i32 bestScore = MIN_EVAL;
    u8 exact = FALSE;
-   u32 evalIdx = 0; // Used for select sort
-   Position prevPos = *pos;
-   for (i32 i = 0; i < size; i++)  {
+   MovePicker mp;
+   init_move_picker(&mp, ttMove, km, ply, thread_num);
+   Move move;
+   i32 moveVal;
+   i32 i;
+   Undo undo;
+   #ifdef DEBUG
+   u64 prev_hash = pos->hash;
+   #endif
+   for (i = 0; (move = next_move(&mp, pos, &moveVal)) != NO_MOVE; i++)  {
       #ifdef DEBUG
-      assert(prevPos.hash == pos->hash);
+      assert(prev_hash == pos->hash);
       #endif
-      evalIdx = helper_select_sort(i, evalIdx, pos, moveList, moveVals, size, km, ttMove, ply, thread_num);
-      makeMove(pos, moveList[i]);
+      makeMove(pos, move, &undo);
+      prefetch_tt(pos->hash);
       i32 score;
       if ( i == 0 ) {
          score = -helper_pv_search(pos, -beta, -alpha, depth - 1, ply + 1, pv_array, km, stats, thread_num);
@@ -732,26 +674,34 @@ i32 helper_pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move
             score = -helper_pv_search(pos, -beta, -alpha, depth - 1, ply + 1, pv_array, km, stats, thread_num);
          }
       }
-      *pos = prevPos;
+      unmakeMove(pos, move, &undo);
+      if(stats->stopped) return SEARCH_STOPPED;
       if( score >= beta ) {
-         store_tt_entry(pos->hash, depth, score, CUT_NODE, moveList[i]);
-         storeKillerMove(km, ply, moveList[i]);
+         store_tt_entry(pos->hash, depth, score, TT_NO_EVAL, CUT_NODE, move);
+         storeKillerMove(km, ply, move);
          return beta;
       }
       if( score > alpha ) {
          alpha = score;
          exact = TRUE;
-         pv_array[ply] = moveList[i];
+         pv_array[ply] = move;
       }
       if( score > bestScore ){
-         bestMove = moveList[i];
+         bestMove = move;
          bestScore = score;
       }
    }
+
+   //Handle Draw or Mate
+   if(i == 0){
+      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
+      else return 0;
+   }
+
    if (exact) {
-      store_tt_entry(pos->hash, depth, alpha, PV_NODE, pv_array[ply]);
+      store_tt_entry(pos->hash, depth, alpha, TT_NO_EVAL, PV_NODE, pv_array[ply]);
    } else {
-      store_tt_entry(pos->hash, depth, bestScore, ALL_NODE, bestMove);
+      store_tt_entry(pos->hash, depth, bestScore, TT_NO_EVAL, ALL_NODE, bestMove);
    }
    return alpha;
 }
@@ -763,27 +713,19 @@ i32 helper_pv_search( Position* pos, i32 alpha, i32 beta, i8 depth, u8 ply, Move
 *
 */
 i32 zw_search( Position* pos, i32 beta, i8 depth, u8 ply, KillerMoves* km, SearchStats* stats, u8 isNull) {
-   if(!run_get_best_move) exit_search(pos);
+   if(searchStopped(stats)) return SEARCH_STOPPED;
    // alpha == beta - 1
    // this is either a cut- or all-node
 
-   stats->node_count++;
+   countNode(stats);
    #ifdef DEBUG
    debug[ZWS][NODE_COUNT]++;
    #endif
 
    if(pos->halfmove_clock >= 100 || isInsufficient(pos) || isRepetition(pos)) return 0;
 
-   Move moveList[MAX_MOVES];
-   i32 moveVals[MAX_MOVES];
-   i32 size = generateLegalMoves(pos, moveList);
-   //Handle Draw or Mate
-   if(size == 0){
-      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
-      else return 0;
-   }
-
-   TTEntryData ttEntry = get_tt_entry(pos->hash);
+   i32 static_eval;
+   TTEntryData ttEntry = get_tt_entry(pos->hash, &static_eval);
    Move ttMove = NO_MOVE;
    if (ttEntry.data) {
       #ifdef DEBUG
@@ -823,8 +765,7 @@ i32 zw_search( Position* pos, i32 beta, i8 depth, u8 ply, KillerMoves* km, Searc
 
    if( depth <= 0 ){
       i32 q_eval = q_search(pos, beta-1, beta, ply, 0, stats);
-      if     (q_eval < beta-1) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE);
-      else if(q_eval >= beta)  store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE);
+      if(stats->stopped) return SEARCH_STOPPED;
       return q_eval;
    }
 
@@ -832,11 +773,16 @@ i32 zw_search( Position* pos, i32 beta, i8 depth, u8 ply, KillerMoves* km, Searc
    char prunable = !(pos->flags & IN_CHECK);
    if(pos->stage == END_GAME) prunable = FALSE;
 
+   // Margins start from the static eval a qsearch left in the TT, material alone when there is none
+   if(static_eval == TT_NO_EVAL) static_eval = eval_material(pos);
+
    //Null move prunin'
    if(prunable && !isNull 
                && depth > NULL_PRUNE_R + 1 
-               && pos->material_eval >= (beta - NMR_MARGIN)){
-      if(pruneNullMoves(pos, beta, depth, ply, km, stats) >= beta){
+               && static_eval >= (beta - NMR_MARGIN)){
+      i32 null_score = pruneNullMoves(pos, beta, depth, ply, km, stats);
+      if(stats->stopped) return SEARCH_STOPPED;
+      if(null_score >= beta){
          #ifdef DEBUG
          debug[ZWS][NODE_PRUNED_NULL]++;
          #endif
@@ -844,46 +790,52 @@ i32 zw_search( Position* pos, i32 beta, i8 depth, u8 ply, KillerMoves* km, Searc
       }
    }
 
+   MovePicker mp;
+   init_move_picker(&mp, ttMove, km, ply, 0);
+   Move move;
+   i32 moveVal;
+   i32 i;
+   Undo undo;
    #ifdef DEBUG
-   if(size > 0) debug[ZWS][NODE_LOOP_CHILDREN]++;
+   u64 prev_hash = pos->hash;
    #endif
-
-   Position prevPos = *pos;
-   u32 evalIdx = 0;
-   for (i32 i = 0; i < size; i++)  {
+   for (i = 0; (move = next_move(&mp, pos, &moveVal)) != NO_MOVE; i++)  {
       #ifdef DEBUG
-      assert(prevPos.hash == pos->hash);
+      assert(prev_hash == pos->hash);
+      if(i == 0) debug[ZWS][NODE_LOOP_CHILDREN]++;
       #endif
       
-      evalIdx = select_sort(i, evalIdx, pos, moveList, moveVals, size, km, ttMove, ply);
-      makeMove(pos, moveList[i]);
+      makeMove(pos, move, &undo);
+      prefetch_tt(pos->hash);
 
       // Set Move prunability prunability ZWS
       u8 prunable_move = prunable;
-      if(i <= PRUNE_MOVE_IDX || pos->flags & IN_CHECK || (GET_FLAGS(moveList[i]) > DOUBLE_PAWN_PUSH) || pos->stage == END_GAME) prunable_move = FALSE;
+      if(i <= PRUNE_MOVE_IDX || pos->flags & IN_CHECK || (GET_FLAGS(move) > DOUBLE_PAWN_PUSH) || pos->stage == END_GAME) prunable_move = FALSE;
 
       if( prunable_move && depth == 1 && abs(beta) < (CHECKMATE_VALUE/2) ){ // Futility Pruning
-         if((prevPos.material_eval + moveVals[i]) < ((beta-1) - ZW_FUTIL_MARGIN)){ 
+         if((static_eval + moveVal) < ((beta-1) - ZW_FUTIL_MARGIN)){ 
             #ifdef DEBUG
             debug[ZWS][NODE_PRUNED_FUTIL]++;
-            #endif // Unmake Move
-            *pos = prevPos;
+            #endif
+            unmakeMove(pos, move, &undo);
             continue;
          }
       }
       
-      char search_depth = getLMRDepth(depth, i, size, moveList[i], prunable_move);
+      // Only quiet moves get reduced and the picker generates every legal move before the first of them, so mp.size is set
+      char search_depth = getLMRDepth(depth, i, mp.size, move, prunable_move);
       #ifdef DEBUG
       debug[ZWS][NODE_LMR_REDUCTIONS] += MAX(((depth - 1) - search_depth), 0);
       //printf("zws further search score %d\n", score);
       #endif
       i32 score = -zw_search(pos, 1-beta, search_depth, ply + 1, km, stats, FALSE);
-      *pos = prevPos; // Unmake Move
+      unmakeMove(pos, move, &undo);
+      if(stats->stopped) return SEARCH_STOPPED;
 
       if( score >= beta ){ // Beta Cutoff
-         store_tt_entry(pos->hash, depth, score, CUT_NODE, moveList[i]);
-         storeKillerMove(km, ply, moveList[i]);
-         //storeHistoryMove(pos->flags, moveList[i], depth);
+         store_tt_entry(pos->hash, depth, score, TT_NO_EVAL, CUT_NODE, move);
+         storeKillerMove(km, ply, move);
+         //storeHistoryMove(pos->flags, move, depth);
          #ifdef DEBUG
          debug[ZWS][NODE_BETA_CUT]++;
          //printf("zws fail hard beta cut %d\n", beta);
@@ -892,6 +844,12 @@ i32 zw_search( Position* pos, i32 beta, i8 depth, u8 ply, KillerMoves* km, Searc
       }
    }
 
+   //Handle Draw or Mate
+   if(i == 0){
+      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
+      else return 0;
+   }
+
    //printf("zws fail %d\n", beta-1);
    #ifdef DEBUG
    debug[ZWS][NODE_ALPHA_RET]++;
@@ -899,10 +857,16 @@ i32 zw_search( Position* pos, i32 beta, i8 depth, u8 ply, KillerMoves* km, Searc
    return beta-1; // fail-hard, return alpha
 }
 
+// Stores a fail hard qsearch result at depth 0, the bound depends on where it landed against the starting window
+static inline void store_q_entry(Position* pos, i32 score, i32 start_alpha, i32 beta, i32 static_eval, Move move){
+   char node_type = score >= beta ? CUT_NODE : score <= start_alpha ? ALL_NODE : PV_NODE;
+   store_tt_entry(pos->hash, 0, score, static_eval, node_type, move);
+}
+
 //quisce search
 i32 q_search( Position* pos, i32 alpha, i32 beta, u8 ply, u8 q_ply, SearchStats* stats) {
-   if(!run_get_best_move) exit_search(pos);
-   stats->node_count++;
+   if(searchStopped(stats)) return SEARCH_STOPPED;
+   countNode(stats);
    #ifdef DEBUG
    debug[QS][NODE_COUNT]++;
    //printf("Pos->Eval in q search: %d\n", pos->eval);
@@ -912,9 +876,39 @@ i32 q_search( Position* pos, i32 alpha, i32 beta, u8 ply, u8 q_ply, SearchStats*
    // Handle Draw or Mate
    if(pos->halfmove_clock >= 100 || isInsufficient(pos) || isRepetition(pos)) return 0;
 
+   // Any stored bound is deep enough for qsearch, and a stored static eval saves evaluating again
+   i32 static_eval;
+   TTEntryData ttEntry = get_tt_entry(pos->hash, &static_eval);
+   if (ttEntry.data) {
+      #ifdef DEBUG
+      debug[QS][NODE_TT_HIT]++;
+      #endif
+      switch (ttEntry.fields.node_type) {
+         case PV_NODE: // Exact value
+            return ttEntry.fields.eval;
+         case CUT_NODE: // Lower bound
+            if (ttEntry.fields.eval >= beta) return beta;
+            break;
+         case ALL_NODE: // Upper bound
+            if (ttEntry.fields.eval <= alpha) return alpha;
+            break;
+         default:
+            break;
+      }
+   }
+   const i32 start_alpha = alpha;
+
    // Check to see if the player can opt to not move and be better
-   i32 stand_pat = eval_position(pos); 
+   // Out of check the eval may stop early with a bound outside (alpha, beta), in check the stand pat raises alpha so it must be exact
+   u8 lazy = FALSE;
+   if(static_eval == TT_NO_EVAL){
+      if(pos->flags & IN_CHECK) static_eval = eval_position(pos, MIN_EVAL, MAX_EVAL, &lazy);
+      else                      static_eval = eval_position(pos, alpha, beta, &lazy);
+   }
+   i32 stand_pat = static_eval;
+   if(lazy) static_eval = TT_NO_EVAL; // Only a bound for this window, the TT static eval slot stays exact
    if(!(pos->flags & IN_CHECK) && stand_pat >= beta){
+      store_tt_entry(pos->hash, 0, beta, static_eval, CUT_NODE, NO_MOVE);
       return beta;
    }
    if( alpha < stand_pat ){
@@ -928,6 +922,7 @@ i32 q_search( Position* pos, i32 alpha, i32 beta, u8 ply, u8 q_ply, SearchStats*
       #ifdef DEBUG
       debug[QS][NODE_PRUNED_FUTIL]++;
       #endif
+      store_tt_entry(pos->hash, 0, alpha, static_eval, ALL_NODE, NO_MOVE);
       return alpha;
    }
    
@@ -945,6 +940,7 @@ i32 q_search( Position* pos, i32 alpha, i32 beta, u8 ply, u8 q_ply, SearchStats*
          }
       }
       else{
+         store_q_entry(pos, alpha, start_alpha, beta, static_eval, NO_MOVE);
          return alpha;
       }
    }
@@ -954,10 +950,14 @@ i32 q_search( Position* pos, i32 alpha, i32 beta, u8 ply, u8 q_ply, SearchStats*
    #ifdef DEBUG
    if(size > 0) debug[QS][NODE_LOOP_CHILDREN]++;
    #endif
-   Position prevPos = *pos;
+   Move bestMove = NO_MOVE;
+   Undo undo;
+   #ifdef DEBUG
+   u64 prev_hash = pos->hash;
+   #endif
    for (i32 i = 0; i < size; i++)  {
       #ifdef DEBUG
-      assert(prevPos.hash == pos->hash);
+      assert(prev_hash == pos->hash);
       #endif
       q_select_sort(i, moveList, moveVals, size); 
 
@@ -971,25 +971,31 @@ i32 q_search( Position* pos, i32 alpha, i32 beta, u8 ply, u8 q_ply, SearchStats*
          continue;
       }
 
-      makeMove(pos, moveList[i]);
+      makeMove(pos, moveList[i], &undo);
+      prefetch_tt(pos->hash);
+      prefetch_eval(pos); // Most qsearch nodes evaluate right after their TT probe
       i32 score = -q_search(pos, -beta, -alpha, ply + 1, q_ply + 1, stats);
-      *pos = prevPos; //Unmake Move
+      unmakeMove(pos, moveList[i], &undo);
+      if(stats->stopped) return SEARCH_STOPPED;
 
       if( score >= beta ){
          // storeKillerMove(ply, moveList[i]);
          #ifdef DEBUG
          debug[QS][NODE_BETA_CUT]++;
          #endif
+         store_tt_entry(pos->hash, 0, beta, static_eval, CUT_NODE, moveList[i]);
          return beta;
       }
       if( score > alpha ){
          alpha = score;
+         bestMove = moveList[i];
       }
    }
 
    #ifdef DEBUG
    debug[QS][NODE_ALPHA_RET]++;
    #endif
+   store_q_entry(pos, alpha, start_alpha, beta, static_eval, bestMove);
    return alpha;
 }
 
@@ -26,6 +26,16 @@ typedef real64 d64;
 #define TRUE 1
 #define FALSE 0
 
+/*
+ * Lookup tables are generated at build time into precomputed.c (make tables) and are read only.
+ * Building with -DRUNTIME_TABLES fills them at startup instead, which is how the generator gets them.
+ */
+#ifdef RUNTIME_TABLES
+#define TABLE_CONST
+#else
+#define TABLE_CONST const
+#endif
+
 #if defined(__PROFILE)
 #define MAX_DEPTH 6
 #endif
@@ -151,6 +161,12 @@ static inline Move MAKE_MOVE(i32 from, i32 to, i32 flags) {
 #define B_LONG_CASTLE  0x02 
 #define TURN_MASK      0x01 
 
+// Masks for Position lazy_valid, the position fields which are computed on first use
+#define LAZY_B_ATTACKS 0x01 // attack_mask[BLACK]
+#define LAZY_W_ATTACKS 0x02 // attack_mask[WHITE]
+#define LAZY_PINNED    0x04 // pinned
+#define LAZY_ALL       0x07
+
 typedef enum{
     BLACK_TURN = 0,
     WHITE_TURN = 1,
@@ -159,10 +175,21 @@ typedef enum{
 } Turn;
 
 typedef enum {
+    PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING
+} PieceType;
+
+typedef enum { // Laid out as color * 6 + PieceType
+    BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING,
     WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING,
-    BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING
+    NO_PIECE
 } PieceIndex;
 
+#define MAKE_PIECE(color, type) ((color) * 6 + (type))
+#define PIECE_COLOR(piece)      ((piece) >= WHITE_PAWN)
+#define PIECE_TYPE(piece)       ((piece) % 6)
+#define PROMO_PIECE_TYPE(flags) (((flags) & 0x3) + KNIGHT) // Promotion flags end in knight, bishop, rook, queen
+
+// FEN characters to PieceIndex and back, only used when reading and printing positions
 static const i32 pieceToIndex[128] = {
     ['P'] = WHITE_PAWN,
     ['N'] = WHITE_KNIGHT,
@@ -178,6 +205,12 @@ static const i32 pieceToIndex[128] = {
     ['k'] = BLACK_KING
 };
 
+static const char indexToPiece[NO_PIECE + 1] = {
+    'p', 'n', 'b', 'r', 'q', 'k',
+    'P', 'N', 'B', 'R', 'Q', 'K',
+    0
+};
+
 #define HASHSTACK_SIZE 100
 
 typedef struct {
@@ -195,15 +228,37 @@ typedef enum {
     END_GAME
 } Stage;
 
+/*
+ * Middle and end game values of an eval term packed in one integer, eg in the high 16 bits and mg in the low 16
+ * so a single add or multiply applies a term to both phases. Each half is an i16 once unpacked, material would not
+ * fit in that so it is summed apart and only the positional terms of the evaluator are packed
+ */
+typedef i32 Score;
+
+#define S(mg, eg) ((Score)((u32)(eg) << 16) + (mg))
+
+static inline i32 mg_value(Score score){
+    return (i16)(u16)(u32)score;
+}
+
+static inline i32 eg_value(Score score){
+    return (i16)(u16)((u32)(score + 0x8000) >> 16); // Adds back the borrow a negative mg half took from eg
+}
+
+typedef struct { // Running sums over the pieces on the board, makeMove updates them for every piece it moves, adds or removes
+    Score psqt[2];    // PST by turn
+    i32 material[2];  // Material by turn, the same in both phases, kings excluded
+    i32 phase_value;  // Phase weights of the pieces left, the middle game share of the eval
+    i32 piece_count;  // Pieces on the board, kings included
+} EvalAccum;
+
 typedef struct {            //Each size of 2 array contains {Black, White}
-    u64 pawn[2];     
-    u64 bishop[2];
-    u64 knight[2];
-    u64 rook[2];
-    u64 queen[2];
-    u64 king[2];
+    union {
+        u64 pieces[2][6];   // Piece bitboards by [color][PieceType]
+        u64 piece_bb[12];   // The same bitboards by PieceIndex
+    };
 
-    u64 attack_mask[2]; // {Attacked by Black, Attacked by White}
+    u64 attack_mask[2]; // {Attacked by Black, Attacked by White}, use getAttackMask()
 
     u64 color[2];  // {White Pieces, Black Pieces}
 
@@ -211,13 +266,21 @@ typedef struct {            //Each size of 2 array contains {Black, White}
     u8 flags;  //Castle aval as bit flags, in order : w_long_castle | w_short_castle | b_long_castle | b_short_castle | turn | in_check | in_double_check
     //1 means avaliable / white's turn
 
-    char charBoard[64];  //Character Board
+    u8 board[64];  //PieceIndex on each square, NO_PIECE if empty
+
+    u64 pinned; //Absolutely pinned pieces, use getPinnedPieces()
+
+    u64 checkers; //Pieces giving check to the side to move
 
-    u64 pinned; //Absolutely pinned pieces
+    u8 lazy_valid; //Which of attack_mask and pinned are up to date
 
     u64 hash; //Hash of the position
 
-    i32 material_eval;
+    u64 pawn_hash; //Hash of the pawns alone, keys the pawn hash table
+
+    EvalAccum accum; //Incremental material, PST and phase, see init_eval_accum()
+
+    HashStack hashStack; // Stack of previous position hashes for repetition checks
 
     i32 hash_stack_idx; // Index of the position in the local hash stack
 
@@ -227,35 +290,24 @@ typedef struct {            //Each size of 2 array contains {Black, White}
     i32 fullmove_number;
 } Position;
 
-typedef struct {
-    u64 pawn[2];     
-    u64 bishop[2];
-    u64 knight[2];
-    u64 rook[2];
-    u64 queen[2];
-    u64 king[2];
-
-    u64 attack_mask[2]; 
-
-    u64 color[2]; 
-
+typedef struct { // State makeMove can't reverse on its own, filled by makeMove and consumed by unmakeMove
     u64 en_passant;
-    u8 flags;
-
-    char charBoard[64];  
-
     u64 pinned;
+    u64 checkers;
+    u64 hash;
+    u64 pawn_hash;
 
-    u64 hash; 
-
-    i32 material_eval;
+    u64 attack_mask[2];
 
-    i32 hash_stack_idx;
+    EvalAccum accum;
+    i32 halfmove_clock;
+    i32 last_reset_idx; // hashStack.last_reset_idx before the move
 
     Stage stage;
 
-    i32 halfmove_clock;
-    i32 fullmove_number;
+    u8 flags;
+    u8 lazy_valid;
+    u8 captured; // PieceIndex of the captured piece, NO_PIECE if none
 } Undo;
 
 typedef struct {
@@ -280,6 +332,9 @@ typedef struct{
     struct timespec end_time;
     double elap_time;
     u64 node_count;
+    _Atomic u64* thread_nodes; // Search thread's node total across iterations, NULL outside of a threaded search
+    i32 poll_countdown;        // Nodes left until the stop flag and limits are checked again
+    u8  stopped;               // Set once the search has to unwind, scores returned after this are meaningless
 } SearchStats;
 
 typedef struct{
@@ -301,6 +356,7 @@ typedef struct{
     u32 rec_time;
     u8  can_shorten;
     u32 depth;
+    u64 max_nodes; // 0 for no node limit
 } SearchParameters;
 
 typedef enum {
@@ -3,6 +3,7 @@
 #include "movement.h"
 #include "types.h"
 #include <stdio.h>
+#include <stdarg.h>
 #include <time.h>
 #include <math.h>
 #include <stdlib.h>
@@ -80,10 +81,9 @@ void printMove(Move move){
 }
 
 /*
- * Prints the provided move as the best move in the UCI format
+ * Writes the move in UCI long algebraic notation, str needs room for 6 chars
  */
-void printBestMove(Move move){
-    char str[6];
+void moveToString(Move move, char* str){
     str[0] = (GET_FROM(move) % 8) + 'a';
     str[1] = (GET_FROM(move) / 8) + '1';
     str[2] = (GET_TO(move) % 8) + 'a';
@@ -114,15 +114,37 @@ void printBestMove(Move move){
         default:
             break;
     }
+}
 
-    #if defined(_WIN32) || defined(_WIN64)
-    printf("bestmove %s\r\n", str);
-    #else
-    printf("bestmove %s\n", str);
-    #endif
+/*
+ * Prints the provided move as the best move in the UCI format
+ */
+#if defined(_WIN32) || defined(_WIN64)
+#define UCI_NEWLINE "\r\n"
+#else
+#define UCI_NEWLINE "\n"
+#endif
+
+/*
+ * Appends to buf with snprintf, returns how much was written without ever running past size
+ */
+static size_t appendf(char* buf, size_t size, size_t len, const char* fmt, ...){
+    if(len >= size) return len;
+    va_list args;
+    va_start(args, fmt);
+    i32 written = vsnprintf(buf + len, size - len, fmt, args);
+    va_end(args);
+    if(written < 0) return len;
+    return MIN(len + (size_t)written, size - 1);
+}
 
-    fflush(stdout);
-    return;
+/*
+ * Writes the bestmove line into buf, returns its length
+ */
+size_t formatBestMove(char* buf, size_t size, Move move){
+    char str[6];
+    moveToString(move, str);
+    return appendf(buf, size, 0, "bestmove %s" UCI_NEWLINE, str);
 }
 
 void printMoveShort(Move move){
@@ -163,32 +185,8 @@ void printMoveSpaced(Move move){
     }
 }
 
-u64 perft(i32 depth, Position pos){
-  Move move_list[256];
-  i32 n_moves, i;
-  u64 nodes = 0;
-
-  if (depth == 0) 
-    return 1ULL;
-
-  n_moves = generateLegalMoves(&pos, move_list);
-
-  for (i = 0; i < n_moves; i++) {
-    Position prevPos = pos;
-    makeMove(&pos, move_list[i]);
-    
-    #ifdef PYTHON
-    checkMoveCount(pos);
-    #endif
-    nodes += perft(depth - 1, pos);
-    pos = prevPos;
-  }
-  
-  return nodes;
-}
-
 char getPiece(Position pos, i32 square){
-    return pos.charBoard[square];
+    return indexToPiece[pos.board[square]];
 }
 
 Move moveStrToType(Position* pos, char* str){
@@ -242,37 +240,53 @@ void printPV(Move *pv_array, i32 depth) {
     }
 }
 
-void printPVInfo(SearchData data){
-    printf("info ");
-    printf("depth %d ", data.depth);
+/*
+ * Writes the info line for data into buf, returns its length
+ */
+size_t formatPVInfo(char* buf, size_t size, SearchData* data){
+    size_t len = appendf(buf, size, 0, "info depth %u ", data->depth);
 
-    i32 score = data.eval;
+    i32 score = data->eval;
     if(abs(score) < CHECKMATE_VALUE - MAX_MOVES){
-        printf("score cp %d ", score/10);
+        len = appendf(buf, size, len, "score cp %d ", score/10);
     }
     else{
         i32 mate = CHECKMATE_VALUE - abs(score);
         mate = (mate + 1) / 2;
         if(score < 0) mate = -mate;
-        printf("score mate %d ", mate);
+        len = appendf(buf, size, len, "score mate %d ", mate);
     }
 
-    printf("time %d ", (int)(data.stats.elap_time * 1000));
-    printf("nodes %lld ", (long long)data.stats.node_count);
-    printf("nps %lld ", (long long)((double)data.stats.node_count / data.stats.elap_time));
-    printf("pv ");
-    printPV(data.pv_array, data.depth);
-    printf("\n");
-    fflush(stdout);
+    i64 nps = data->stats.elap_time > 0 ? (i64)((double)data->stats.node_count / data->stats.elap_time) : 0;
+    len = appendf(buf, size, len, "time %d nodes %llu nps %lld pv",
+                  (i32)(data->stats.elap_time * 1000), (unsigned long long)data->stats.node_count, (long long)nps);
+    for (u32 i = 0; i < data->depth; i++) {
+        if(data->pv_array[i] == NO_MOVE) continue;
+        char str[6];
+        moveToString(data->pv_array[i], str);
+        len = appendf(buf, size, len, " %s", str);
+    }
+    return appendf(buf, size, len, UCI_NEWLINE);
 }
 
-Stage calculateStage(Position pos){
+Stage calculateStage(const Position* pos){
     Stage stage = MID_GAME;
-    if(pos.fullmove_number < OPN_GAME_MOVES) stage = OPN_GAME; 
-    if(count_bits(pos.color[0] | pos.color[1]) <= END_GAME_PIECES) stage = END_GAME;
+    if(pos->fullmove_number < OPN_GAME_MOVES) stage = OPN_GAME; 
+    if(pos->accum.piece_count <= END_GAME_PIECES) stage = END_GAME;
     return stage;
 }
 
+/*
+ * Number of cores online, used for work that should spread over the whole machine
+ */
+u32 online_cpus(){
+    #ifdef _SC_NPROCESSORS_ONLN
+    return MAX(1, sysconf(_SC_NPROCESSORS_ONLN));
+    #else
+    return 1;
+    #endif
+}
+
 u64 millis(){
     struct timespec _t;
     clock_gettime(CLOCK_REALTIME, &_t);
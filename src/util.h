@@ -12,26 +12,34 @@
 #define DEBUG_PRINT(x) do {} while (0)
 #endif
 
+// Hint a cache line in ahead of a probe, build with -DNO_PREFETCH to measure without
+#ifdef NO_PREFETCH
+#define PREFETCH(addr) ((void)(addr))
+#else
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#endif
+
 
 #include "types.h"
 void printMove(Move move);
-void printBestMove(Move move);
+void moveToString(Move move, char* str);
+size_t formatBestMove(char* buf, size_t size, Move move);
 void printMoveShort(Move move);
 void printMoveSpaced(Move move);
-u64 perft(i32 depth, Position pos);
 i32 checkMoveCount(Position pos);
 i32 python_init();
 i32 python_close();
 
 Move moveStrToType(Position* pos, char* str);
-Stage calculateStage(Position pos);
+Stage calculateStage(const Position* pos);
 u32 calculate_rec_search_time(u32 wtime, u32 winc, u32 btime, u32 binc, u32 moves_remain, u8 turn);
 u32 calculate_max_search_time(u32 wtime, u32 winc, u32 btime, u32 binc, u32 moves_remain, u8 turn);
 
 void printPV(Move *pv_array, i32 depth);
-void printPVInfo(SearchData data);
+size_t formatPVInfo(char* buf, size_t size, SearchData* data);
 
 u64 millis();
+u32 online_cpus();
 
 static inline i32 getlsb(uint64_t bb) {
     return __builtin_ctzll(bb);
@@ -68,7 +76,7 @@ static inline void movcpy (Move* pTarget, const Move* pSource, i32 n) {
 static inline u8 canPromotePawn(Position *pos){
    u8 turn = pos->flags & WHITE_TURN;
    u64 row = turn ? 0x00FF000000000000ULL : 0x000000000000FF00ULL;
-   return (pos->pawn[turn] & row) != 0;
+   return (pos->pieces[turn][PAWN] & row) != 0;
 }
 
 /*
@@ -80,13 +88,13 @@ static inline u8 isInsufficient(Position* pos){
    u32 piece_count_b = count_bits(pos->color[1]);
    if(piece_count_w == 1 && piece_count_b == 1) return TRUE;
    if(piece_count_w <= 2 && piece_count_b == 1){
-      if((pos->knight[0] | pos->bishop[0])) return TRUE; 
+      if((pos->pieces[0][KNIGHT] | pos->pieces[0][BISHOP])) return TRUE; 
    }
    if(piece_count_w == 1 && piece_count_b <= 2){
-      if((pos->knight[1] | pos->bishop[1])) return TRUE;
+      if((pos->pieces[1][KNIGHT] | pos->pieces[1][BISHOP])) return TRUE;
    }
    if(piece_count_w <= 2 && piece_count_b <= 2){
-      if((pos->knight[0] | pos->bishop[0]) && (pos->knight[1] | pos->bishop[1])) return TRUE;
+      if((pos->pieces[0][KNIGHT] | pos->pieces[0][BISHOP]) && (pos->pieces[1][KNIGHT] | pos->pieces[1][BISHOP])) return TRUE;
    }
    return FALSE;
 }